@@ -0,0 +1,224 @@
+#include "../Data Structures/Heap.cpp"
+#include "../Data Structures/DaryHeap.cpp"
+#include "../Data Structures/IndexedHeap.cpp"
+#include "../Data Structures/PairingHeap.cpp"
+#include "../Data Structures/FibonacciHeap.cpp"
+#include <vector>
+#include <random>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+
+/*
+	Benchmark of the priority queues on Dijkstra and Prim over dense graphs (every pair of vertices has an edge)
+	Dense graphs are where decreaseKey matters: there are V^2 edge relaxations but only V pops
+	The heaps without decreaseKey (the int Heap and DaryHeap) get the usual lazy version instead: push the vertex again whenever
+	its key drops and skip the stale copies when they come out. The int Heap is a max heap of ints, so it gets -(key*V + vertex)
+	IndexedHeap, PairingHeap and FibonacciHeap push every vertex once and call decreaseKey
+	Every heap has to agree on the sum of the shortest path distances and on the weight of the minimum spanning tree
+	Usage: HeapBenchmark [number of vertices] [repetitions]
+*/
+
+typedef std::pair<int, int> KeyVertex;
+
+// complete directed graph as a V x V matrix of weights from 1 to maxWeight (the diagonal is unused)
+struct DenseGraph {
+	int vertices;
+	std::vector<int> weights;
+
+	int weight(int from, int to) const {
+		return weights[(size_t)from * vertices + to];
+	}
+};
+
+DenseGraph randomDenseGraph(int vertices, int maxWeight, bool symmetric, std::mt19937_64& generator) {
+	DenseGraph graph;
+	graph.vertices = vertices;
+	graph.weights = std::vector<int>((size_t)vertices * vertices);
+	for (int from = 0; from < vertices; from++) {
+		for (int to = 0; to < vertices; to++) {
+			graph.weights[(size_t)from * vertices + to] = 1 + (int)(generator() % maxWeight);
+		}
+	}
+	if (symmetric) {
+		for (int from = 0; from < vertices; from++) {
+			for (int to = 0; to < from; to++) {
+				graph.weights[(size_t)from * vertices + to] = graph.weight(to, from);
+			}
+		}
+	}
+	return graph;
+}
+
+/*
+	Both algorithms are the same loop: pop the closest vertex, then offer every other vertex a new key
+	Dijkstra offers dist[u] + w(u, v), Prim offers w(u, v), and both only take keys that are smaller than the current one
+	The result is the sum of the final keys (the total shortest path distance, or the weight of the spanning tree)
+*/
+inline int64_t offeredKey(bool prim, int keyOfU, int weight) {
+	return prim ? weight : (int64_t)keyOfU + weight;
+}
+
+// lazy version on the original int Heap, with (key, vertex) encoded as -(key*V + vertex) so the max is the smallest key
+int64_t runIntHeap(const DenseGraph& graph, bool prim) {
+	int n = graph.vertices;
+	std::vector<int> key = std::vector<int>(n, INT_MAX);
+	std::vector<bool> done = std::vector<bool>(n, false);
+	Heap heap;
+	key[0] = 0;
+	heap.push(0);
+	int64_t total = 0;
+	while (heap.size > 0) {
+		int encoded = -heap.pop();
+		int u = encoded % n;
+		if (done[u] || encoded / n != key[u]) continue;
+		done[u] = true;
+		total += key[u];
+		for (int v = 0; v < n; v++) {
+			if (done[v]) continue;
+			int64_t candidate = offeredKey(prim, key[u], graph.weight(u, v));
+			if (candidate < key[v]) {
+				if (candidate > (INT_MAX - n) / n) {
+					throw "Key too large to encode in an int!";
+				}
+				key[v] = (int)candidate;
+				heap.push(-(key[v] * n + v));
+			}
+		}
+	}
+	return total;
+}
+
+// lazy version on DaryHeap (a min heap through std::greater)
+template<unsigned D>
+int64_t runDaryHeap(const DenseGraph& graph, bool prim) {
+	int n = graph.vertices;
+	std::vector<int> key = std::vector<int>(n, INT_MAX);
+	std::vector<bool> done = std::vector<bool>(n, false);
+	DaryHeap<KeyVertex, D, std::greater<KeyVertex>> heap;
+	key[0] = 0;
+	heap.push(KeyVertex(0, 0));
+	int64_t total = 0;
+	while (!heap.empty()) {
+		KeyVertex top = heap.pop();
+		int u = top.second;
+		if (done[u] || top.first != key[u]) continue;
+		done[u] = true;
+		total += key[u];
+		for (int v = 0; v < n; v++) {
+			if (done[v]) continue;
+			int64_t candidate = offeredKey(prim, key[u], graph.weight(u, v));
+			if (candidate < key[v]) {
+				key[v] = (int)candidate;
+				heap.push(KeyVertex(key[v], v));
+			}
+		}
+	}
+	return total;
+}
+
+int64_t runIndexedHeap(const DenseGraph& graph, bool prim) {
+	int n = graph.vertices;
+	std::vector<int> key = std::vector<int>(n, INT_MAX);
+	std::vector<bool> done = std::vector<bool>(n, false);
+	IndexedHeap<int> heap = IndexedHeap<int>(n);
+	key[0] = 0;
+	for (int v = 0; v < n; v++) heap.push(v, key[v]);
+	int64_t total = 0;
+	while (!heap.empty()) {
+		int u = (int)heap.pop();
+		done[u] = true;
+		total += key[u];
+		for (int v = 0; v < n; v++) {
+			if (done[v]) continue;
+			int64_t candidate = offeredKey(prim, key[u], graph.weight(u, v));
+			if (candidate < key[v]) {
+				key[v] = (int)candidate;
+				heap.decreaseKey(v, key[v]);
+			}
+		}
+	}
+	return total;
+}
+
+// PairingHeap and FibonacciHeap have the same interface, so one version covers both
+template<class MeldableHeap>
+int64_t runMeldableHeap(const DenseGraph& graph, bool prim) {
+	int n = graph.vertices;
+	std::vector<int> key = std::vector<int>(n, INT_MAX);
+	std::vector<bool> done = std::vector<bool>(n, false);
+	std::vector<typename MeldableHeap::Handle> handles = std::vector<typename MeldableHeap::Handle>(n);
+	MeldableHeap heap;
+	key[0] = 0;
+	for (int v = 0; v < n; v++) handles[v] = heap.push(KeyVertex(key[v], v));
+	int64_t total = 0;
+	while (!heap.empty()) {
+		int u = heap.pop().second;
+		done[u] = true;
+		total += key[u];
+		for (int v = 0; v < n; v++) {
+			if (done[v]) continue;
+			int64_t candidate = offeredKey(prim, key[u], graph.weight(u, v));
+			if (candidate < key[v]) {
+				key[v] = (int)candidate;
+				heap.decreaseKey(handles[v], KeyVertex(key[v], v));
+			}
+		}
+	}
+	return total;
+}
+
+// best time in seconds over the repetitions, and the result of the last run
+double timeRun(std::function<int64_t(const DenseGraph&, bool)> run, const DenseGraph& graph, bool prim, int repetitions, int64_t& result) {
+	double best = 0;
+	for (int r = 0; r < repetitions; r++) {
+		auto start = std::chrono::steady_clock::now();
+		result = run(graph, prim);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (r == 0 || seconds < best) best = seconds;
+	}
+	return best;
+}
+
+void benchmarkAlgorithm(const char* name, const DenseGraph& graph, bool prim, int repetitions) {
+	struct Candidate {
+		const char* name;
+		std::function<int64_t(const DenseGraph&, bool)> run;
+	};
+	Candidate candidates[] = {
+		{ "Heap (int, lazy)", runIntHeap },
+		{ "DaryHeap<4> (lazy)", runDaryHeap<4> },
+		{ "IndexedHeap", runIndexedHeap },
+		{ "PairingHeap", runMeldableHeap<PairingHeap<KeyVertex>> },
+		{ "FibonacciHeap", runMeldableHeap<FibonacciHeap<KeyVertex>> },
+	};
+
+	printf("%s on %d vertices (%lld edges)\n", name, graph.vertices, (long long)graph.vertices * (graph.vertices - 1));
+	int64_t expected = 0;
+	for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+		int64_t result = 0;
+		double seconds = timeRun(candidates[i].run, graph, prim, repetitions, result);
+		if (i == 0) expected = result;
+		printf("  %-20s %8.3f ms   result %lld%s\n", candidates[i].name, 1e3 * seconds, (long long)result, result == expected ? "" : "   (MISMATCH!)");
+	}
+}
+
+int main(int argc, char** argv) {
+	int vertices = argc > 1 ? atoi(argv[1]) : 4000;
+	int repetitions = argc > 2 ? atoi(argv[2]) : 3;
+	if (vertices < 1 || repetitions < 1) {
+		printf("Usage: HeapBenchmark [number of vertices] [repetitions]\n");
+		return 1;
+	}
+	std::mt19937_64 generator(42);
+	// small weights give many ties and many decreaseKeys, like road and network graphs with integer costs
+	DenseGraph directed = randomDenseGraph(vertices, 1000, false, generator);
+	benchmarkAlgorithm("Dijkstra", directed, false, repetitions);
+	DenseGraph undirected = randomDenseGraph(vertices, 1000, true, generator);
+	benchmarkAlgorithm("Prim", undirected, true, repetitions);
+	return 0;
+}
@@ -0,0 +1,147 @@
+#include "../Data Structures/Heap.cpp"
+#include "../Data Structures/MultiQueue.cpp"
+#include "../Sorting/ParallelHelpers.cpp"
+#include <vector>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+/*
+	Benchmark of MultiQueue against the int Heap behind a single mutex, on 1, 2, 4, ... up to 64 threads
+	Every thread does the classic steady state loop of a scheduler: pop an element, push a new random one (so the size stays put)
+	and we report the throughput in millions of operations (a push or a pop) per second
+	The second table is the price we pay: the average and max rank error of MultiQueue pops for a few rank error bounds,
+	measured on one thread (the rank error of a pop is how many elements in the queue were larger than the one it returned)
+	The bound is on the expected rank error, so we check the average against it (and exit with 1 if it is over)
+	Past the number of hardware threads the threads share cores, so that part of the curve shows oversubscription, not scaling
+	Usage: MultiQueueBenchmark [max threads] [initial size] [operations per thread] [rank error bound, 0 for 2 heaps per thread]
+*/
+
+const int KEY_BITS = 20;
+const int KEY_RANGE = 1 << KEY_BITS;
+
+// the int Heap behind one mutex, the obvious way to share a priority queue
+class LockedHeap {
+public:
+	void push(int value) {
+		std::lock_guard<std::mutex> guard(lock);
+		heap.push(value);
+	}
+
+	bool tryPop(int& result) {
+		std::lock_guard<std::mutex> guard(lock);
+		if (heap.size == 0) return false;
+		result = heap.pop();
+		return true;
+	}
+
+private:
+	std::mutex lock;
+	Heap heap;
+};
+
+// runs the pop/push loop on numThreads threads and returns millions of operations per second
+template<class Queue>
+double measureThroughput(Queue& queue, unsigned numThreads, int initialSize, int operationsPerThread) {
+	std::mt19937 generator(1);
+	for (int i = 0; i < initialSize; i++) queue.push((int)(generator() % KEY_RANGE));
+
+	// every thread waits for the others before starting, so we do not time the thread creation
+	std::atomic<unsigned> ready(0);
+	std::chrono::steady_clock::time_point start;
+	runOnThreads(numThreads, [&](unsigned id) {
+		std::mt19937 local(id + 2);
+		ready.fetch_add(1);
+		while (ready.load() < numThreads) std::this_thread::yield();
+		if (id == 0) start = std::chrono::steady_clock::now();
+		for (int i = 0; i < operationsPerThread; i++) {
+			int value;
+			queue.tryPop(value);
+			queue.push((int)(local() % KEY_RANGE));
+		}
+	});
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return 2.0 * numThreads * operationsPerThread / seconds / 1e6;
+}
+
+// Fenwick tree over the keys, to count how many elements in the queue are larger than a popped one
+class KeyCounter {
+public:
+	KeyCounter() : tree(KEY_RANGE + 1, 0) {}
+
+	void add(int key, int delta) {
+		for (int i = key + 1; i <= KEY_RANGE; i += i & -i) tree[i] += delta;
+	}
+
+	// number of keys <= key
+	int64_t countUpTo(int key) const {
+		int64_t total = 0;
+		for (int i = key + 1; i > 0; i -= i & -i) total += tree[i];
+		return total;
+	}
+
+private:
+	std::vector<int64_t> tree;
+};
+
+// returns whether the average rank error stayed within the bound
+bool measureRankError(size_t maxRankError, int initialSize, int operations) {
+	MultiQueue<int> queue(1, maxRankError);
+	KeyCounter counter;
+	std::mt19937 generator(3);
+	for (int i = 0; i < initialSize; i++) {
+		int key = (int)(generator() % KEY_RANGE);
+		queue.push(key);
+		counter.add(key, 1);
+	}
+	int64_t size = initialSize;
+	int64_t totalError = 0;
+	int64_t maxError = 0;
+	for (int i = 0; i < operations; i++) {
+		int key = queue.pop();
+		int64_t error = size - counter.countUpTo(key);
+		totalError += error;
+		if (error > maxError) maxError = error;
+		counter.add(key, -1);
+		key = (int)(generator() % KEY_RANGE);
+		queue.push(key);
+		counter.add(key, 1);
+	}
+	double average = (double)totalError / operations;
+	bool withinBound = average <= queue.maxRankError();
+	printf("  bound %4zu   average %8.2f   max %6lld   %s\n", queue.maxRankError(), average, (long long)maxError, withinBound ? "ok" : "OVER THE BOUND!");
+	return withinBound;
+}
+
+int main(int argc, char** argv) {
+	unsigned maxThreads = argc > 1 ? (unsigned)atoi(argv[1]) : 64;
+	int initialSize = argc > 2 ? atoi(argv[2]) : 1000000;
+	int operationsPerThread = argc > 3 ? atoi(argv[3]) : 200000;
+	int maxRankError = argc > 4 ? atoi(argv[4]) : 0;
+	if (maxThreads < 1 || initialSize < 0 || operationsPerThread < 1 || maxRankError < 0) {
+		printf("Usage: MultiQueueBenchmark [max threads] [initial size] [operations per thread] [rank error bound, 0 for 2 heaps per thread]\n");
+		return 1;
+	}
+
+	printf("Throughput in Mops/s (%u hardware threads, %d elements, %d pop+push per thread)\n", resolveThreadCount(0), initialSize, operationsPerThread);
+	printf("  %7s %14s %14s %9s %8s\n", "threads", "LockedHeap", "MultiQueue", "speedup", "bound");
+	for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+		LockedHeap locked;
+		double lockedRate = measureThroughput(locked, threads, initialSize, operationsPerThread);
+		MultiQueue<int> multi(threads, maxRankError);
+		double multiRate = measureThroughput(multi, threads, initialSize, operationsPerThread);
+		printf("  %7u %14.2f %14.2f %8.2fx %8zu\n", threads, lockedRate, multiRate, multiRate / lockedRate, multi.maxRankError());
+	}
+
+	printf("Rank error of MultiQueue pops (one thread, %d elements)\n", initialSize);
+	bool allWithinBound = true;
+	for (size_t bound = 2; bound <= 256; bound *= 4) {
+		allWithinBound = measureRankError(bound, initialSize, 200000) && allWithinBound;
+	}
+	return allWithinBound ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include "../Sorting/QuickSort.cpp"
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+/*
+	Benchmark of block partition against the lomuto loop in partitionRange
+	We partition the same random arrays with both and report nanoseconds per element and the speedup
+	Then we also run the full vector<int> quicksort with the LOMUTO and BLOCK schemes
+	Usage: PartitionBenchmark [number of elements] [repetitions]
+*/
+
+// random values for each of the element types we benchmark
+template<typename T>
+std::vector<T> randomVector(size_t n, std::mt19937_64& generator);
+
+template<>
+std::vector<int32_t> randomVector<int32_t>(size_t n, std::mt19937_64& generator) {
+	std::vector<int32_t> result(n);
+	for (size_t i = 0; i < n; i++) result[i] = (int32_t)generator();
+	return result;
+}
+
+template<>
+std::vector<int64_t> randomVector<int64_t>(size_t n, std::mt19937_64& generator) {
+	std::vector<int64_t> result(n);
+	for (size_t i = 0; i < n; i++) result[i] = (int64_t)generator();
+	return result;
+}
+
+template<>
+std::vector<double> randomVector<double>(size_t n, std::mt19937_64& generator) {
+	std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+	std::vector<double> result(n);
+	for (size_t i = 0; i < n; i++) result[i] = distribution(generator);
+	return result;
+}
+
+// runs partitionFunction on a fresh copy of every input and returns the total time in seconds
+template<typename T, class PartitionFunction>
+double timePartition(const std::vector<std::vector<T>>& inputs, PartitionFunction partitionFunction, size_t& checksum) {
+	using namespace std;
+	double total = 0;
+	for (size_t i = 0; i < inputs.size(); i++) {
+		vector<T> arr = inputs[i];
+		auto start = chrono::steady_clock::now();
+		typename vector<T>::iterator pivot = partitionFunction(arr.begin(), arr.end());
+		total += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		// using the result so that the partition cannot be optimized away (both schemes must agree on the pivot position)
+		checksum += pivot - arr.begin();
+	}
+	return total;
+}
+
+template<typename T>
+void benchmarkType(const char* typeName, size_t n, int repetitions, std::mt19937_64& generator) {
+	using namespace std;
+	vector<vector<T>> inputs;
+	for (int i = 0; i < repetitions; i++) {
+		inputs.push_back(randomVector<T>(n, generator));
+	}
+
+	size_t lomutoChecksum = 0;
+	size_t blockChecksum = 0;
+	typedef typename vector<T>::iterator Iterator;
+	double lomuto = timePartition(inputs, [](Iterator first, Iterator last) { return partitionRange(first, last, less<T>()); }, lomutoChecksum);
+	double block = timePartition(inputs, [](Iterator first, Iterator last) { return blockPartitionRange(first, last, less<T>()); }, blockChecksum);
+	if (lomutoChecksum != blockChecksum) {
+		printf("%s: partitions disagree on the pivot position!\n", typeName);
+	}
+
+	double elements = (double)n * repetitions;
+	printf("%-8s lomuto %7.3f ns/element   block %7.3f ns/element   speedup %.2fx\n", typeName, 1e9 * lomuto / elements, 1e9 * block / elements, lomuto / block);
+}
+
+// full quicksort of the vector<int> entry point with a given partition scheme, in seconds
+double timeQuicksort(const std::vector<int>& input, PartitionScheme scheme) {
+	using namespace std;
+	vector<int> arr = input;
+	auto start = chrono::steady_clock::now();
+	quicksort(arr, 0, (int)arr.size() - 1, true, scheme);
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+	using namespace std;
+	size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1 << 24;
+	int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+	mt19937_64 generator(42);
+
+	printf("partitioning %zu random elements, %d repetitions\n", n, repetitions);
+	benchmarkType<int32_t>("int32", n, repetitions, generator);
+	benchmarkType<int64_t>("int64", n, repetitions, generator);
+	benchmarkType<double>("double", n, repetitions, generator);
+
+	vector<int32_t> input = randomVector<int32_t>(n, generator);
+	srand(42);
+	double lomuto = timeQuicksort(input, LOMUTO);
+	srand(42);
+	double block = timeQuicksort(input, BLOCK);
+	printf("quicksort on int32: lomuto %.3f s   block %.3f s   speedup %.2fx\n", lomuto, block, lomuto / block);
+	return 0;
+}
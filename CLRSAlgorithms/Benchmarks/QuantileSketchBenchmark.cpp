@@ -0,0 +1,140 @@
+#include "../Selection/QuantileSketch.cpp"
+#include "../Sorting/Introsort.cpp"
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+/*
+	Accuracy check and benchmark of the KLL sketch in Selection/QuantileSketch.cpp
+	For every input distribution we feed the stream to:
+		one sketch that sees the whole stream
+		8 sketches that each see a contiguous eighth of it, merged into one (what one sketch per thread would do)
+		that merged sketch sent through toBytes and fromBytes
+	and compare every percentile and the rank of every percentile against the exact answer from the sorted stream
+	Before that, verifyExactQuantiles checks the exact mode (k > n) on small streams of every distribution
+	The error of an answer is how far its true rank is from the rank we asked for, as a fraction of n (with duplicates, the true rank
+	of an item is a whole interval and we take the closest end). Every error has to stay within normalizedRankError(),
+	otherwise we print the offending case and exit with 1, so this doubles as the test of the sketch
+	Usage: QuantileSketchBenchmark [number of items] [k]
+*/
+
+const int MERGED_SKETCHES = 8;
+
+std::vector<int64_t> generateStream(const char* distribution, size_t n, std::mt19937_64& generator) {
+	std::vector<int64_t> stream(n);
+	std::string name = distribution;
+	for (size_t i = 0; i < n; i++) {
+		if (name == "uniform") stream[i] = (int64_t)(generator() >> 1);
+		else if (name == "sorted") stream[i] = (int64_t)i;
+		else if (name == "reverse") stream[i] = (int64_t)(n - i);
+		// a few hundred values, so most items share their rank with many others
+		else stream[i] = (int64_t)(generator() % 300);
+	}
+	return stream;
+}
+
+// distance in ranks from target to the closest rank item occupies in sorted (any rank in [first, last) of its copies is correct)
+uint64_t rankDistance(const std::vector<int64_t>& sorted, int64_t item, uint64_t target) {
+	uint64_t first = std::lower_bound(sorted.begin(), sorted.end(), item) - sorted.begin();
+	uint64_t last = std::upper_bound(sorted.begin(), sorted.end(), item) - sorted.begin();
+	if (target < first) return first - target;
+	if (last > 0 && target > last - 1) return target - (last - 1);
+	return 0;
+}
+
+// largest normalized error over every percentile and the rank of every percentile
+double maxNormalizedError(const KllSketch<int64_t>& sketch, const std::vector<int64_t>& sorted) {
+	double n = (double)sorted.size();
+	double worst = 0;
+	for (int percent = 0; percent <= 100; percent++) {
+		double q = percent / 100.0;
+		uint64_t target = (uint64_t)(q * (sorted.size() - 1));
+		worst = std::max(worst, rankDistance(sorted, sketch.quantile(q), target) / n);
+
+		// rank counts the items that are less than the query
+		int64_t item = sorted[target];
+		uint64_t exact = std::lower_bound(sorted.begin(), sorted.end(), item) - sorted.begin();
+		uint64_t estimate = sketch.rank(item);
+		worst = std::max(worst, (estimate > exact ? estimate - exact : exact - estimate) / n);
+	}
+	return worst;
+}
+
+bool checkDistribution(const char* distribution, size_t n, uint32_t k, std::mt19937_64& generator) {
+	std::vector<int64_t> stream = generateStream(distribution, n, generator);
+
+	auto start = std::chrono::steady_clock::now();
+	KllSketch<int64_t> whole(k);
+	for (size_t i = 0; i < n; i++) whole.update(stream[i]);
+	double updateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// every part gets its own seed, as sketches on different threads would
+	KllSketch<int64_t> merged(k, 1);
+	for (int part = 0; part < MERGED_SKETCHES; part++) {
+		KllSketch<int64_t> partial(k, 100 + part);
+		for (size_t i = part * n / MERGED_SKETCHES; i < (part + 1) * n / MERGED_SKETCHES; i++) partial.update(stream[i]);
+		merged.merge(partial);
+	}
+	std::vector<unsigned char> bytes = merged.toBytes();
+	KllSketch<int64_t> restored = KllSketch<int64_t>::fromBytes(bytes);
+
+	start = std::chrono::steady_clock::now();
+	std::vector<int64_t> sorted = stream;
+	introsort(sorted.begin(), sorted.end());
+	double sortSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	double bound = whole.normalizedRankError();
+	double errors[] = { maxNormalizedError(whole, sorted), maxNormalizedError(merged, sorted), maxNormalizedError(restored, sorted) };
+	bool ok = restored.count() == n && merged.count() == n;
+	for (int i = 0; i < 3; i++) ok = ok && errors[i] <= bound;
+
+	printf("  %-8s %8.2f ns/item %8.2f ns/item %7zu items %7zu bytes   %.4f%% %.4f%% %.4f%%  %s\n", distribution,
+		1e9 * updateSeconds / n, 1e9 * sortSeconds / n, whole.retained(), bytes.size(),
+		100 * errors[0], 100 * errors[1], 100 * errors[2], ok ? "ok" : "OVER THE BOUND!");
+	return ok;
+}
+
+// exact mode on small streams, every percentile has to match introselect
+bool checkExactMode(const char* const* distributions, size_t numDistributions, std::mt19937_64& generator) {
+	std::vector<double> qs;
+	for (int percent = 0; percent <= 100; percent++) qs.push_back(percent / 100.0);
+	const size_t sizes[] = { 1, 2, 3, 10, 101, 1000 };
+	bool ok = true;
+	for (size_t i = 0; i < numDistributions; i++) {
+		for (size_t j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+			if (!verifyExactQuantiles(generateStream(distributions[i], sizes[j], generator), qs)) {
+				printf("  exact mode is wrong on %s with %zu items!\n", distributions[i], sizes[j]);
+				ok = false;
+			}
+		}
+	}
+	return ok;
+}
+
+int main(int argc, char** argv) {
+	long long n = argc > 1 ? atoll(argv[1]) : 10000000;
+	long long k = argc > 2 ? atoll(argv[2]) : KllSketch<int64_t>::DEFAULT_K;
+	if (n < 1 || k < 2 || k > 1000000000) {
+		printf("Usage: QuantileSketchBenchmark [number of items] [k]\n");
+		return 1;
+	}
+	std::mt19937_64 generator(42);
+	const char* distributions[] = { "uniform", "sorted", "reverse", "few" };
+	const size_t numDistributions = sizeof(distributions) / sizeof(distributions[0]);
+	bool ok = checkExactMode(distributions, numDistributions, generator);
+	printf("Exact mode (k > n, whole, merged and fromBytes against introselect): %s\n", ok ? "ok" : "WRONG!");
+
+	KllSketch<int64_t> bound((uint32_t)k);
+	printf("KLL sketch with k = %lld on %lld items, every error has to stay within %.4f%%\n", k, n, 100 * bound.normalizedRankError());
+	printf("  %-8s %16s %16s %13s %13s   %s\n", "input", "update", "introsort", "retained", "toBytes", "max error (whole, merged, fromBytes)");
+
+	for (size_t i = 0; i < numDistributions; i++) {
+		ok = checkDistribution(distributions[i], (size_t)n, (uint32_t)k, generator) && ok;
+	}
+	return ok ? 0 : 1;
+}
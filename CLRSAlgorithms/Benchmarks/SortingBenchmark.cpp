@@ -0,0 +1,364 @@
+#include "../Sorting/QuickSort.cpp"
+#include "../Sorting/InsertionSort.cpp"
+#include "../Sorting/Introsort.cpp"
+#include "../Sorting/MergeSort.cpp"
+#include "../Sorting/NonComparisonSort.cpp"
+#include "../Sorting/StringSort.cpp"
+#include "../Data Structures/Heap.cpp"
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <new>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+	Benchmark suite for the sorts in Sorting/ (and heapsort from Data Structures/Heap.cpp)
+	Every sort runs over every input distribution, size and element type, and we print one JSON object with all the results
+	so runs can be diffed or loaded into a notebook to track regressions
+	Distributions: uniform, sorted, reverse, organ pipe (ascending then descending), few unique (16 values), zipf (s = 1)
+	and nearly sorted (sorted with 1% of the elements swapped at random)
+	Types: int32, int64, double and string (zero padded numbers behind a common prefix, so string order matches the number order)
+	Sizes go up by factors of 10 from 1K to the max on the command line (1B ints need a few GB per copy, so pick the types to match)
+	For every run we report:
+		seconds: median time over the repetitions, and elementsPerSecond computed from it
+		comparisons and moves: counted on a second run over a wrapper type (Counted<T>) for the comparison sorts,
+		  null for sorts that do not compare elements (radix, counting, bucket and string sorts) or above the counting limit
+		peakBytes: largest amount of heap memory the sort had allocated at once on top of its input (through an operator new override)
+		sorted: whether the output was actually sorted
+	Quadratic sorts (insertion sort, and the vector<int> Lomuto quicksort which is quadratic on few unique values) are skipped above their limits
+	Usage: SortingBenchmark [max elements] [repetitions] [max elements for counted runs] [types, e.g. int32,int64,double,string] > results.json
+*/
+
+// heap memory tracking, every allocation gets a header that remembers its size so delete can subtract it
+const size_t ALLOCATION_HEADER = 16;
+std::atomic<size_t> currentBytes(0);
+std::atomic<size_t> peakBytes(0);
+
+void* operator new(size_t size) {
+	char* block = (char*)std::malloc(size + ALLOCATION_HEADER);
+	if (block == nullptr) throw std::bad_alloc();
+	*(size_t*)block = size;
+	size_t current = currentBytes.fetch_add(size) + size;
+	size_t peak = peakBytes.load();
+	while (current > peak && !peakBytes.compare_exchange_weak(peak, current)) {}
+	return block + ALLOCATION_HEADER;
+}
+
+void operator delete(void* pointer) noexcept {
+	if (pointer == nullptr) return;
+	// going through uintptr_t, since some compilers warn about free on a pointer that came out of operator new
+	void* block = (void*)((uintptr_t)pointer - ALLOCATION_HEADER);
+	currentBytes.fetch_sub(*(size_t*)block);
+	std::free(block);
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete[](void* pointer) noexcept {
+	operator delete(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+	operator delete(pointer);
+}
+
+// comparison and move counters for Counted<T> (atomic, since the parallel sorts compare from several threads)
+std::atomic<uint64_t> comparisonCount(0);
+std::atomic<uint64_t> moveCount(0);
+
+// wrapper that counts every comparison and every copy or move of the value it holds
+template<typename T>
+struct Counted {
+	T value;
+
+	Counted() : value() {}
+	Counted(const Counted& other) : value(other.value) { moveCount.fetch_add(1, std::memory_order_relaxed); }
+	Counted(Counted&& other) : value(std::move(other.value)) { moveCount.fetch_add(1, std::memory_order_relaxed); }
+	Counted& operator=(const Counted& other) {
+		value = other.value;
+		moveCount.fetch_add(1, std::memory_order_relaxed);
+		return *this;
+	}
+	Counted& operator=(Counted&& other) {
+		value = std::move(other.value);
+		moveCount.fetch_add(1, std::memory_order_relaxed);
+		return *this;
+	}
+	bool operator<(const Counted& other) const {
+		comparisonCount.fetch_add(1, std::memory_order_relaxed);
+		return value < other.value;
+	}
+};
+
+/*
+	Inputs are generated as 31 bit keys first and then turned into the element type with an order preserving conversion,
+	so the same distribution looks the same for every type
+*/
+enum Distribution { UNIFORM, SORTED, REVERSE, ORGAN_PIPE, FEW_UNIQUE, ZIPF, NEARLY_SORTED };
+const char* DISTRIBUTION_NAMES[] = { "uniform", "sorted", "reverse", "organPipe", "fewUnique", "zipf", "nearlySorted" };
+const int NUM_DISTRIBUTIONS = 7;
+const uint64_t KEY_RANGE = 1ull << 31;
+
+std::vector<uint64_t> generateKeys(Distribution distribution, size_t n, std::mt19937_64& generator) {
+	using namespace std;
+	vector<uint64_t> keys(n);
+	if (distribution == FEW_UNIQUE) {
+		for (size_t i = 0; i < n; i++) keys[i] = (generator() % 16) * (KEY_RANGE / 16);
+		return keys;
+	}
+	if (distribution == ZIPF) {
+		// inverse transform over the cumulative distribution of ranks 1..ranks with P(rank) proportional to 1/rank
+		size_t ranks = max<size_t>(1, min<size_t>(n, 1 << 20));
+		vector<double> cumulative(ranks);
+		double sum = 0;
+		for (size_t rank = 0; rank < ranks; rank++) {
+			sum += 1.0 / (rank + 1);
+			cumulative[rank] = sum;
+		}
+		uniform_real_distribution<double> uniform(0, sum);
+		// scatter the ranks over the key range so the most frequent values are not also the smallest ones
+		uint64_t multiplier = 2654435761ull;
+		for (size_t i = 0; i < n; i++) {
+			size_t rank = lower_bound(cumulative.begin(), cumulative.end(), uniform(generator)) - cumulative.begin();
+			keys[i] = (min(rank, ranks - 1) * multiplier) % KEY_RANGE;
+		}
+		return keys;
+	}
+
+	for (size_t i = 0; i < n; i++) keys[i] = generator() % KEY_RANGE;
+	if (distribution == UNIFORM) return keys;
+	sort(keys.begin(), keys.end());
+	if (distribution == REVERSE) {
+		reverse(keys.begin(), keys.end());
+	}
+	else if (distribution == ORGAN_PIPE) {
+		// every other key ascending, then the rest descending
+		vector<uint64_t> pipe(n);
+		size_t front = 0;
+		size_t back = n;
+		for (size_t i = 0; i < n; i++) {
+			if (i % 2 == 0) pipe[front++] = keys[i];
+			else pipe[--back] = keys[i];
+		}
+		keys.swap(pipe);
+	}
+	else if (distribution == NEARLY_SORTED) {
+		for (size_t swaps = 0; swaps < n / 100; swaps++) {
+			swap(keys[generator() % n], keys[generator() % n]);
+		}
+	}
+	return keys;
+}
+
+template<typename T>
+T keyToValue(uint64_t key);
+
+template<>
+int32_t keyToValue<int32_t>(uint64_t key) {
+	return (int32_t)((int64_t)key - (int64_t)(KEY_RANGE / 2));
+}
+
+template<>
+int64_t keyToValue<int64_t>(uint64_t key) {
+	return ((int64_t)key - (int64_t)(KEY_RANGE / 2)) * 1000003;
+}
+
+template<>
+double keyToValue<double>(uint64_t key) {
+	return (double)key / KEY_RANGE - 0.5;
+}
+
+template<>
+std::string keyToValue<std::string>(uint64_t key) {
+	char digits[16];
+	std::snprintf(digits, sizeof(digits), "%010llu", (unsigned long long)key);
+	return std::string("https://example.com/users/") + digits;
+}
+
+/*
+	A sort under test: sort runs on the plain element type, countedSort (only set for comparison sorts) on Counted<T>
+	maxSize skips the sort for larger inputs
+*/
+template<typename T>
+struct Algorithm {
+	std::string name;
+	size_t maxSize;
+	std::function<void(std::vector<T>&)> sort;
+	std::function<void(std::vector<Counted<T>>&)> countedSort;
+};
+
+const size_t NO_LIMIT = (size_t)-1;
+const size_t QUADRATIC_LIMIT = 1 << 14;
+
+// sort is a generic lambda, so the same sort gets instantiated for T and for Counted<T>
+template<typename T, class Sort>
+Algorithm<T> comparisonSort(const char* name, size_t maxSize, Sort sort) {
+	Algorithm<T> algorithm;
+	algorithm.name = name;
+	algorithm.maxSize = maxSize;
+	algorithm.sort = sort;
+	algorithm.countedSort = sort;
+	return algorithm;
+}
+
+template<typename T, class Sort>
+Algorithm<T> otherSort(const char* name, size_t maxSize, Sort sort) {
+	Algorithm<T> algorithm;
+	algorithm.name = name;
+	algorithm.maxSize = maxSize;
+	algorithm.sort = sort;
+	return algorithm;
+}
+
+// the comparison sorts that work on every element type
+template<typename T>
+std::vector<Algorithm<T>> comparisonSorts() {
+	std::vector<Algorithm<T>> algorithms;
+	algorithms.push_back(comparisonSort<T>("std::sort", NO_LIMIT, [](auto& v) { std::sort(v.begin(), v.end()); }));
+	algorithms.push_back(comparisonSort<T>("std::stable_sort", NO_LIMIT, [](auto& v) { std::stable_sort(v.begin(), v.end()); }));
+	algorithms.push_back(comparisonSort<T>("insertionSort", QUADRATIC_LIMIT, [](auto& v) { insertionSort(v.begin(), v.end()); }));
+	algorithms.push_back(comparisonSort<T>("quicksort", NO_LIMIT, [](auto& v) { quicksort(v.begin(), v.end(), std::less<>()); }));
+	algorithms.push_back(comparisonSort<T>("parallelQuicksort", NO_LIMIT, [](auto& v) { parallelQuicksort(v.begin(), v.end(), std::less<>()); }));
+	algorithms.push_back(comparisonSort<T>("introsort", NO_LIMIT, [](auto& v) { introsort(v.begin(), v.end()); }));
+	algorithms.push_back(comparisonSort<T>("heapsort", NO_LIMIT, [](auto& v) { Heap::heapsort(v.begin(), v.end(), std::less<>()); }));
+	algorithms.push_back(comparisonSort<T>("mergeSort", NO_LIMIT, [](auto& v) { mergeSort(v.begin(), v.end()); }));
+	algorithms.push_back(comparisonSort<T>("parallelMergeSort", NO_LIMIT, [](auto& v) { parallelMergeSort(v.begin(), v.end(), std::less<>()); }));
+	algorithms.push_back(comparisonSort<T>("timSort", NO_LIMIT, [](auto& v) { timSort(v.begin(), v.end()); }));
+	return algorithms;
+}
+
+// sorts that only exist for some element types
+template<typename T>
+void addTypeSpecificSorts(std::vector<Algorithm<T>>& algorithms);
+
+template<>
+void addTypeSpecificSorts<int32_t>(std::vector<Algorithm<int32_t>>& algorithms) {
+	// the original vector<int> entry points (Lomuto is quadratic on few unique values, so it gets a limit)
+	algorithms.push_back(otherSort<int32_t>("quicksort(vector<int>) lomuto", QUADRATIC_LIMIT, [](std::vector<int32_t>& v) { quicksort(v, 0, (int)v.size() - 1, true, LOMUTO); }));
+	algorithms.push_back(otherSort<int32_t>("quicksort(vector<int>) threeWay", NO_LIMIT, [](std::vector<int32_t>& v) { quicksort(v, 0, (int)v.size() - 1, true, THREE_WAY); }));
+	algorithms.push_back(otherSort<int32_t>("quicksort(vector<int>) block", QUADRATIC_LIMIT, [](std::vector<int32_t>& v) { quicksort(v, 0, (int)v.size() - 1, true, BLOCK); }));
+	algorithms.push_back(otherSort<int32_t>("mergeSort(vector<int>)", NO_LIMIT, [](std::vector<int32_t>& v) { v = mergeSort(v); }));
+	algorithms.push_back(otherSort<int32_t>("radixSortLSD", NO_LIMIT, [](std::vector<int32_t>& v) { radixSortLSD(v); }));
+	algorithms.push_back(otherSort<int32_t>("radixSortMSD", NO_LIMIT, [](std::vector<int32_t>& v) { radixSortMSD(v); }));
+	algorithms.push_back(otherSort<int32_t>("countingSortParallel", NO_LIMIT, [](std::vector<int32_t>& v) { countingSortParallel(v); }));
+}
+
+template<>
+void addTypeSpecificSorts<int64_t>(std::vector<Algorithm<int64_t>>& algorithms) {
+	algorithms.push_back(otherSort<int64_t>("radixSortLSD", NO_LIMIT, [](std::vector<int64_t>& v) { radixSortLSD(v); }));
+	algorithms.push_back(otherSort<int64_t>("radixSortMSD", NO_LIMIT, [](std::vector<int64_t>& v) { radixSortMSD(v); }));
+	algorithms.push_back(otherSort<int64_t>("countingSortParallel", NO_LIMIT, [](std::vector<int64_t>& v) { countingSortParallel(v); }));
+}
+
+template<>
+void addTypeSpecificSorts<double>(std::vector<Algorithm<double>>& algorithms) {
+	algorithms.push_back(otherSort<double>("radixSortLSD", NO_LIMIT, [](std::vector<double>& v) { radixSortLSD(v); }));
+	algorithms.push_back(otherSort<double>("radixSortMSD", NO_LIMIT, [](std::vector<double>& v) { radixSortMSD(v); }));
+	algorithms.push_back(otherSort<double>("bucketSort", NO_LIMIT, [](std::vector<double>& v) { bucketSort(v); }));
+}
+
+template<>
+void addTypeSpecificSorts<std::string>(std::vector<Algorithm<std::string>>& algorithms) {
+	algorithms.push_back(otherSort<std::string>("multikeyQuicksort", NO_LIMIT, [](std::vector<std::string>& v) { multikeyQuicksort(v.begin(), v.end()); }));
+	algorithms.push_back(otherSort<std::string>("lcpMergeSort", NO_LIMIT, [](std::vector<std::string>& v) { lcpMergeSort(v.begin(), v.end()); }));
+}
+
+// true for the first result we print, so we know when to put a comma in front
+bool firstResult = true;
+
+template<typename T>
+void benchmarkType(const char* typeName, const std::vector<size_t>& sizes, int repetitions, size_t countLimit, std::mt19937_64& generator) {
+	using namespace std;
+	vector<Algorithm<T>> algorithms = comparisonSorts<T>();
+	addTypeSpecificSorts<T>(algorithms);
+
+	for (size_t s = 0; s < sizes.size(); s++) {
+		size_t n = sizes[s];
+		for (int d = 0; d < NUM_DISTRIBUTIONS; d++) {
+			vector<uint64_t> keys = generateKeys((Distribution)d, n, generator);
+			vector<T> input(n);
+			for (size_t i = 0; i < n; i++) input[i] = keyToValue<T>(keys[i]);
+			keys = vector<uint64_t>();
+
+			for (size_t a = 0; a < algorithms.size(); a++) {
+				const Algorithm<T>& algorithm = algorithms[a];
+				if (n > algorithm.maxSize) continue;
+				fprintf(stderr, "%s %s n=%zu %s\n", typeName, DISTRIBUTION_NAMES[d], n, algorithm.name.c_str());
+
+				vector<double> times;
+				times.reserve(repetitions);
+				size_t peak = 0;
+				bool sorted = true;
+				for (int r = 0; r < repetitions; r++) {
+					vector<T> arr = input;
+					size_t baseline = currentBytes.load();
+					peakBytes.store(baseline);
+					auto start = chrono::steady_clock::now();
+					algorithm.sort(arr);
+					times.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+					peak = max(peak, peakBytes.load() - baseline);
+					sorted = sorted && is_sorted(arr.begin(), arr.end());
+				}
+				sort(times.begin(), times.end());
+				double seconds = times[times.size() / 2];
+
+				char counts[96] = "\"comparisons\": null, \"moves\": null";
+				if (algorithm.countedSort && n <= countLimit) {
+					vector<Counted<T>> arr(n);
+					for (size_t i = 0; i < n; i++) arr[i].value = input[i];
+					comparisonCount.store(0);
+					moveCount.store(0);
+					algorithm.countedSort(arr);
+					snprintf(counts, sizeof(counts), "\"comparisons\": %llu, \"moves\": %llu", (unsigned long long)comparisonCount.load(), (unsigned long long)moveCount.load());
+				}
+
+				printf("%s\n    {\"algorithm\": \"%s\", \"type\": \"%s\", \"distribution\": \"%s\", \"n\": %zu, \"repetitions\": %d, "
+					"\"seconds\": %.9f, \"elementsPerSecond\": %.1f, %s, \"peakBytes\": %zu, \"sorted\": %s}",
+					firstResult ? "" : ",", algorithm.name.c_str(), typeName, DISTRIBUTION_NAMES[d], n, repetitions,
+					seconds, seconds > 0 ? n / seconds : 0.0, counts, peak, sorted ? "true" : "false");
+				firstResult = false;
+				fflush(stdout);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	using namespace std;
+	size_t maxSize = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+	int repetitions = argc > 2 ? atoi(argv[2]) : 3;
+	size_t countLimit = argc > 3 ? strtoull(argv[3], nullptr, 10) : 1000000;
+	string types = argc > 4 ? argv[4] : "int32,int64,double,string";
+	if (repetitions < 1) repetitions = 1;
+	mt19937_64 generator(42);
+	// seeds rand() for the randomized pivots of the vector<int> quicksort
+	srand(42);
+
+	vector<size_t> sizes;
+	for (size_t n = 1000; n <= maxSize; n *= 10) sizes.push_back(n);
+	if (sizes.empty() || sizes.back() != maxSize) sizes.push_back(maxSize);
+
+	printf("{\"benchmark\": \"sorting\", \"repetitions\": %d, \"threads\": %u, \"results\": [", repetitions, resolveThreadCount(0));
+	// looking for every type name in the list (types are separated by commas)
+	string list = "," + types + ",";
+	if (list.find(",int32,") != string::npos) benchmarkType<int32_t>("int32", sizes, repetitions, countLimit, generator);
+	if (list.find(",int64,") != string::npos) benchmarkType<int64_t>("int64", sizes, repetitions, countLimit, generator);
+	if (list.find(",double,") != string::npos) benchmarkType<double>("double", sizes, repetitions, countLimit, generator);
+	if (list.find(",string,") != string::npos) benchmarkType<string>("string", sizes, repetitions, countLimit, generator);
+	printf("\n]}\n");
+	return 0;
+}
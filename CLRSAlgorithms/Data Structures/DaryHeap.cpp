@@ -0,0 +1,208 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+/*
+	Allocator that hands out memory starting on a cache line (64 bytes), so a vector can rely on where its elements sit in cache
+	We over allocate by a cache line and keep the pointer we really got from operator new right in front of the aligned block
+*/
+const size_t CACHE_LINE_SIZE = 64;
+
+template<typename T>
+struct CacheAlignedAllocator {
+	typedef T value_type;
+
+	CacheAlignedAllocator() {}
+
+	template<typename U>
+	CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+	T* allocate(size_t n) {
+		if (n > (SIZE_MAX - CACHE_LINE_SIZE - sizeof(void*)) / sizeof(T)) throw std::bad_alloc();
+		char* raw = (char*)::operator new(n * sizeof(T) + CACHE_LINE_SIZE + sizeof(void*));
+		uintptr_t aligned = ((uintptr_t)(raw + sizeof(void*)) + CACHE_LINE_SIZE - 1) & ~(uintptr_t)(CACHE_LINE_SIZE - 1);
+		((void**)aligned)[-1] = raw;
+		return (T*)aligned;
+	}
+
+	void deallocate(T* pointer, size_t) {
+		::operator delete(((void**)pointer)[-1]);
+	}
+};
+
+template<typename T, typename U>
+bool operator==(const CacheAlignedAllocator<T>&, const CacheAlignedAllocator<U>&) { return true; }
+
+template<typename T, typename U>
+bool operator!=(const CacheAlignedAllocator<T>&, const CacheAlignedAllocator<U>&) { return false; }
+
+/*
+	d-ary heap: a heap where every node has D children instead of 2, for any element type and comparator
+	Like Heap, it is a max heap with respect to cmp (so DaryHeap<T, 4, std::greater<T>> is a min heap, no negating the inputs),
+	unlike IndexedHeap, PairingHeap and FibonacciHeap, the CLRS min heaps, whose comparator is called less to make that visible
+	The tree is only log_D(n) levels deep, so pop walks half (D = 4) or a third (D = 8) of the levels of a binary heap.
+	Every level costs D-1 comparisons to find the largest child, but those children are next to each other in memory:
+	we keep the array on a cache line boundary and shifted by D-1 slots, so that the children of every node start at a multiple of D.
+	With D*sizeof(T) = 64 (D = 8 for 8 byte elements, or D = 4 for 16 byte elements) every group of children is exactly one cache line,
+	and a pop on a large heap costs about one cache miss per level instead of one per comparison
+	Sifts move a hole instead of swapping, so every level costs one move instead of a swap (three moves)
+*/
+template<typename T, unsigned D = 4, class Compare = std::less<T>>
+class DaryHeap {
+	static_assert(D >= 2, "A heap needs at least 2 children per node");
+
+public:
+	DaryHeap(Compare cmp = Compare()) {
+		this->cmp = cmp;
+		// the D-1 padding slots in front of the root
+		items = Storage(D - 1);
+	}
+
+	size_t size() const {
+		return items.size() - (D - 1);
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	void reserve(size_t n) {
+		items.reserve(n + D - 1);
+	}
+
+	// return the current maximum of the heap without removing it
+	const T& top() const {
+		if (empty()) {
+			throw "Heap is empty!";
+		}
+		return at(0);
+	}
+
+	// push a new value onto the heap (sift up operation), O(log_D(n))
+	void push(const T& value) {
+		items.push_back(value);
+		siftUp(size() - 1);
+	}
+
+	void push(T&& value) {
+		items.push_back(std::move(value));
+		siftUp(size() - 1);
+	}
+
+	/*
+		Pushes a whole range at once: when the range is at least as large as the heap, we append everything and heapify the whole
+		array bottom up in O(n) (like Heap's constructor), instead of paying O(log(n)) per element
+		Smaller ranges are sifted up one by one, which is cheaper than touching the whole heap
+	*/
+	template<class InputIterator>
+	void pushBulk(InputIterator first, InputIterator last) {
+		size_t oldSize = size();
+		items.insert(items.end(), first, last);
+		size_t n = size();
+		if (n - oldSize >= oldSize) {
+			heapify();
+		}
+		else {
+			for (size_t i = oldSize; i < n; i++) {
+				siftUp(i);
+			}
+		}
+	}
+
+	// return the current maximum of the heap and remove it from the heap, O(D*log_D(n))
+	T pop() {
+		if (empty()) {
+			throw "Heap is empty!";
+		}
+		T result = std::move(at(0));
+		T last = std::move(items.back());
+		items.pop_back();
+		if (!empty()) {
+			// the last element drops into the hole at the root and sinks down
+			siftDown(0, std::move(last));
+		}
+		return result;
+	}
+
+	void clear() {
+		items.resize(D - 1);
+	}
+
+	// this function is just a sanity check to verify that heap invariant is maintained
+	bool verifyHeap() const {
+		for (size_t i = 1; i < size(); i++) {
+			if (cmp(at(parent(i)), at(i))) return false;
+		}
+		return true;
+	}
+
+	static inline size_t parent(size_t index) {
+		return (index - 1) / D;
+	}
+
+	static inline size_t firstChild(size_t index) {
+		return D * index + 1;
+	}
+
+private:
+	typedef std::vector<T, CacheAlignedAllocator<T>> Storage;
+
+	Compare cmp;
+	// heap index i lives in items[i + D - 1], so the children of i start at items[D*(i+1)]
+	Storage items;
+
+	T& at(size_t index) {
+		return items[index + D - 1];
+	}
+
+	const T& at(size_t index) const {
+		return items[index + D - 1];
+	}
+
+	// sift up for the entry at index, moving a hole up instead of swapping
+	void siftUp(size_t index) {
+		T value = std::move(at(index));
+		while (index > 0) {
+			size_t parentIndex = parent(index);
+			if (!cmp(at(parentIndex), value)) break;
+			at(index) = std::move(at(parentIndex));
+			index = parentIndex;
+		}
+		at(index) = std::move(value);
+	}
+
+	// value goes into the hole at index and sinks down until none of the children is larger
+	void siftDown(size_t index, T value) {
+		size_t n = size();
+		while (true) {
+			size_t child = firstChild(index);
+			if (child >= n) break;
+
+			// largest of the (up to) D children, all in the same cache line
+			size_t end = child + D < n ? child + D : n;
+			size_t maxChild = child;
+			for (size_t i = child + 1; i < end; i++) {
+				if (cmp(at(maxChild), at(i))) maxChild = i;
+			}
+
+			if (!cmp(value, at(maxChild))) break;
+			at(index) = std::move(at(maxChild));
+			index = maxChild;
+		}
+		at(index) = std::move(value);
+	}
+
+	// bottom up heapify of the whole array, the leaves are already heaps so we start at the parent of the last element
+	void heapify() {
+		size_t n = size();
+		if (n < 2) return;
+		for (size_t i = parent(n - 1) + 1; i-- > 0;) {
+			siftDown(i, std::move(at(i)));
+		}
+	}
+};
@@ -0,0 +1,258 @@
+#pragma once
+#include "NodePool.cpp"
+#include <functional>
+#include <utility>
+#include <cstddef>
+
+/*
+	Fibonacci heap as in CLRS chapter 19: a min heap (with respect to less) made of a circular list of heap ordered trees
+	push, top, meld and decreaseKey are O(1) amortized and pop is O(log(n)) amortized
+	push and meld only add to the root list; pop moves the children of the minimum into the root list and then consolidates,
+	linking roots of equal degree until every degree is unique
+	decreaseKey cuts the node out to the root list, and cascading cut makes sure no node loses more than one child
+	before being cut itself (that is what the mark is for), which keeps a tree of degree d at least Fibonacci(d+2) large
+	Same interface as PairingHeap: push returns a Handle (a node pointer) that decreaseKey takes, and the handle stays valid until
+	its node is popped, also after a meld
+	Order: as in CLRS, minimum (what top returns) is the smallest key with respect to less, the reverse of Heap and DaryHeap
+*/
+template<typename T, class Less = std::less<T>>
+class FibonacciHeap {
+public:
+	struct Node {
+		T key;
+		Node* parent;
+		Node* child;
+		Node* left;
+		Node* right;
+		int degree;
+		bool mark;
+	};
+	typedef Node* Handle;
+
+	FibonacciHeap(Less less = Less()) {
+		this->less = less;
+		minimum = nullptr;
+		count = 0;
+	}
+
+	// the nodes belong to the pool, so a heap cannot be copied (it can be melded into another one)
+	FibonacciHeap(const FibonacciHeap&) = delete;
+	FibonacciHeap& operator=(const FibonacciHeap&) = delete;
+
+	size_t size() const {
+		return count;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	// CLRS FIB-HEAP-INSERT
+	Handle push(const T& key) {
+		Node* node = pool.allocate();
+		node->key = key;
+		node->parent = nullptr;
+		node->child = nullptr;
+		node->degree = 0;
+		node->mark = false;
+		node->left = node;
+		node->right = node;
+		addToRootList(node);
+		count++;
+		return node;
+	}
+
+	// return the current minimum of the heap without removing it
+	const T& top() const {
+		if (empty()) {
+			throw "Heap is empty!";
+		}
+		return minimum->key;
+	}
+
+	// CLRS FIB-HEAP-EXTRACT-MIN, returns the minimum (handles to it are invalid afterwards)
+	T pop() {
+		if (empty()) {
+			throw "Heap is empty!";
+		}
+		Node* z = minimum;
+		T result = std::move(z->key);
+
+		// every child of z becomes a root
+		if (z->child != nullptr) {
+			Node* child = z->child;
+			do {
+				child->parent = nullptr;
+				child = child->right;
+			} while (child != z->child);
+			splice(z, z->child);
+		}
+
+		if (z->right == z) {
+			minimum = nullptr;
+		}
+		else {
+			minimum = z->right;
+			unlink(z);
+			consolidate();
+		}
+		pool.release(z);
+		count--;
+		return result;
+	}
+
+	// the key of a handle that is still in the heap
+	const T& key(Handle node) const {
+		return node->key;
+	}
+
+	// CLRS FIB-HEAP-DECREASE-KEY
+	void decreaseKey(Handle x, const T& key) {
+		if (less(x->key, key)) {
+			throw "New key is larger than current key!";
+		}
+		x->key = key;
+		Node* y = x->parent;
+		if (y != nullptr && less(x->key, y->key)) {
+			cut(x, y);
+			cascadingCut(y);
+		}
+		if (less(x->key, minimum->key)) minimum = x;
+	}
+
+	// CLRS FIB-HEAP-UNION: concatenates the root lists in O(1) (plus splicing the node pools), other ends up empty
+	void meld(FibonacciHeap& other) {
+		if (&other == this || other.minimum == nullptr) return;
+		if (minimum == nullptr) {
+			minimum = other.minimum;
+		}
+		else {
+			splice(minimum, other.minimum);
+			if (less(other.minimum->key, minimum->key)) minimum = other.minimum;
+		}
+		count += other.count;
+		pool.splice(other.pool);
+		other.minimum = nullptr;
+		other.count = 0;
+	}
+
+	void clear() {
+		pool.clear();
+		minimum = nullptr;
+		count = 0;
+	}
+
+private:
+	// a tree of degree d has at least Fibonacci(d+2) nodes, so 64 bit sizes keep every degree below 93
+	static const int MAX_DEGREE = 96;
+
+	Less less;
+	// root with the minimum key, it is also our entry point to the root list
+	Node* minimum;
+	size_t count;
+	NodePool<Node> pool;
+
+	// inserts the circular list that starts at list right after node (both lists become one)
+	static void splice(Node* node, Node* list) {
+		Node* listLast = list->left;
+		Node* nodeRight = node->right;
+		node->right = list;
+		list->left = node;
+		listLast->right = nodeRight;
+		nodeRight->left = listLast;
+	}
+
+	// takes node out of its circular list and makes it a list of its own
+	static void unlink(Node* node) {
+		node->left->right = node->right;
+		node->right->left = node->left;
+		node->left = node;
+		node->right = node;
+	}
+
+	void addToRootList(Node* node) {
+		if (minimum == nullptr) {
+			minimum = node;
+			return;
+		}
+		splice(minimum, node);
+		if (less(node->key, minimum->key)) minimum = node;
+	}
+
+	// CLRS FIB-HEAP-LINK: y (a root) becomes a child of x (a root)
+	void link(Node* y, Node* x) {
+		unlink(y);
+		if (x->child == nullptr) {
+			x->child = y;
+		}
+		else {
+			splice(x->child, y);
+		}
+		y->parent = x;
+		x->degree++;
+		y->mark = false;
+	}
+
+	// CLRS CONSOLIDATE: links roots of the same degree until every root has a different degree, then finds the new minimum
+	void consolidate() {
+		Node* degrees[MAX_DEGREE];
+		for (int i = 0; i < MAX_DEGREE; i++) degrees[i] = nullptr;
+
+		// counting the roots first, since linking takes roots out of the list we walk
+		int roots = 0;
+		Node* node = minimum;
+		do {
+			roots++;
+			node = node->right;
+		} while (node != minimum);
+
+		node = minimum;
+		for (int i = 0; i < roots; i++) {
+			Node* x = node;
+			node = node->right;
+			int d = x->degree;
+			while (degrees[d] != nullptr) {
+				Node* y = degrees[d];
+				if (less(y->key, x->key)) std::swap(x, y);
+				link(y, x);
+				degrees[d] = nullptr;
+				d++;
+			}
+			degrees[d] = x;
+		}
+
+		// the roots left are exactly the non null entries of degrees, they are still linked as a circular list
+		minimum = nullptr;
+		for (int d = 0; d < MAX_DEGREE; d++) {
+			if (degrees[d] != nullptr && (minimum == nullptr || less(degrees[d]->key, minimum->key))) {
+				minimum = degrees[d];
+			}
+		}
+	}
+
+	// CLRS CUT: x goes from the child list of y to the root list
+	void cut(Node* x, Node* y) {
+		if (y->child == x) {
+			y->child = x->right == x ? nullptr : x->right;
+		}
+		unlink(x);
+		y->degree--;
+		x->parent = nullptr;
+		x->mark = false;
+		splice(minimum, x);
+	}
+
+	// CLRS CASCADING-CUT
+	void cascadingCut(Node* y) {
+		Node* z = y->parent;
+		while (z != nullptr) {
+			if (!y->mark) {
+				y->mark = true;
+				return;
+			}
+			cut(y, z);
+			y = z;
+			z = y->parent;
+		}
+	}
+};
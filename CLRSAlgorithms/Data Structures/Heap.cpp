@@ -1,4 +1,9 @@
+#pragma once
 #include <vector>
+#include <iterator>
+#include <utility>
+#include <functional>
+#include <cstddef>
 
 
 /*
@@ -81,32 +86,123 @@ public:
 			int left = leftChild(i);
 			int right = rightChild(i);
 
-			if (left <= size && arr[i] < arr[left]) {
+			if (left < size && arr[i] < arr[left]) {
 				return false;
 			}
 
-			if (right <= size && arr[i] < arr[right]) {
+			if (right < size && arr[i] < arr[right]) {
 				return false;
 			}
 		}
 		return true;
 	}
 
-	// heapsort for an array (in place) (O(nlog(n)) time ) 
-	static void heapsort(std::vector<int> arr) {
-		if (arr.size() == 0) return;
-		// initializing some instance of the class	
-		// initializing the heap with the class already invokes heapify, so now arr is a max-heap
-		Heap sorter = Heap(arr);
-		for (int i = sorter.size - 1; i >= 0; i--) {
-			int temp = arr[i];
-			arr[i] = arr[0];
-			arr[0] = temp;
-			sorter.size--;
-			sorter.siftDown(0);
+	// heapsort for an array (in place) (O(nlog(n)) time )
+	static void heapsort(std::vector<int>& arr) {
+		heapsort(arr.begin(), arr.end(), std::less<int>());
+	}
+
+	// heapsort for any random access range with a comparator (in place, O(nlog(n)) time)
+	// the range is turned into a max heap with respect to cmp, so it ends up sorted in ascending order
+	// both phases use the bottom up sift down below, so it takes about nlog(n) comparisons instead of 2nlog(n)
+	// this is the worst case fallback that introsort uses
+	template<class RandomAccessIterator, class Compare>
+	static void heapsort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+		if (last - first < 2) return;
+		makeHeap(first, last, cmp);
+		sortHeap(first, last, cmp);
+	}
+
+	// the static helpers below work on any random access range that is a max heap with respect to cmp
+	// (TopK and partialSort build on them as well)
+
+	// turns the range into a max heap with the same linear time heapify as the constructor (leaves are already heaps)
+	template<class RandomAccessIterator, class Compare>
+	static void makeHeap(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+		std::ptrdiff_t n = last - first;
+		for (std::ptrdiff_t i = n / 2 - 1; i >= 0; i--) {
+			siftDownBottomUp(first, i, n, cmp);
 		}
+	}
 
-		// now arr is sorted in place!
+	// turns a max heap into a range sorted in ascending order by moving the max to the back over and over
+	template<class RandomAccessIterator, class Compare>
+	static void sortHeap(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+		for (std::ptrdiff_t end = (last - first) - 1; end > 0; end--) {
+			std::iter_swap(first, first + end);
+			siftDownBottomUp(first, 0, end, cmp);
+		}
+	}
+
+	// sift up for the entry at index (after it was appended to the heap), moving a hole up instead of swapping
+	template<class RandomAccessIterator, class Compare>
+	static void siftUp(RandomAccessIterator first, std::ptrdiff_t index, Compare cmp) {
+		auto value = std::move(*(first + index));
+		while (index > 0) {
+			std::ptrdiff_t parentIndex = (index - 1) / 2;
+			if (!cmp(*(first + parentIndex), value)) break;
+			*(first + index) = std::move(*(first + parentIndex));
+			index = parentIndex;
+		}
+		*(first + index) = std::move(value);
+	}
+
+	// sift down on the first size entries of a random access range that is a max heap with respect to cmp
+	// we move a hole down instead of swapping at every level, which saves a write per level
+	template<class RandomAccessIterator, class Compare>
+	static void siftDown(RandomAccessIterator first, std::ptrdiff_t index, std::ptrdiff_t size, Compare cmp) {
+		auto value = std::move(*(first + index));
+		do {
+			std::ptrdiff_t left = 2 * index + 1;
+			if (left >= size) break;
+
+			std::ptrdiff_t maxIndex = left;
+			if (left + 1 < size && cmp(*(first + left), *(first + left + 1))) maxIndex = left + 1;
+
+			if (cmp(value, *(first + maxIndex))) {
+				*(first + index) = std::move(*(first + maxIndex));
+				index = maxIndex;
+			}
+			else {
+				break;
+			}
+		} while (true);
+		*(first + index) = std::move(value);
+	}
+
+	/*
+		Floyd's bottom up sift down, same result as siftDown but with about half the comparisons
+		siftDown compares the two children and then the value against the larger one, so 2 comparisons per level.
+		But in heapsort the value we sift down is the one we just took from the bottom of the heap, so it almost always goes
+		back down to (or next to) a leaf anyway. So we walk the path of larger children all the way to a leaf without looking
+		at the value (1 comparison per level), then climb back up from the leaf until we find the spot where the value fits,
+		which is usually just a level or two
+	*/
+	template<class RandomAccessIterator, class Compare>
+	static void siftDownBottomUp(RandomAccessIterator first, std::ptrdiff_t index, std::ptrdiff_t size, Compare cmp) {
+		std::ptrdiff_t start = index;
+		auto value = std::move(*(first + index));
+		std::ptrdiff_t right = 2 * index + 2;
+		while (right < size) {
+			std::ptrdiff_t maxIndex = cmp(*(first + right), *(first + right - 1)) ? right - 1 : right;
+			*(first + index) = std::move(*(first + maxIndex));
+			index = maxIndex;
+			right = 2 * index + 2;
+		}
+		// a last left child without a right sibling
+		if (right == size) {
+			*(first + index) = std::move(*(first + right - 1));
+			index = right - 1;
+		}
+
+		// climbing back up from the leaf, but no higher than where we started
+		while (index > start) {
+			std::ptrdiff_t parentIndex = (index - 1) / 2;
+			if (!cmp(*(first + parentIndex), value)) break;
+			*(first + index) = std::move(*(first + parentIndex));
+			index = parentIndex;
+		}
+		*(first + index) = std::move(value);
 	}
 
 	// returning the index of the parent
@@ -156,7 +252,7 @@ private:
 
 			int right = rightChild(index);
 			int maxIndex = left;
-			if (right < size && arr[right] < arr[left]) maxIndex = right;
+			if (right < size && arr[left] < arr[right]) maxIndex = right;
 			
 			if (arr[index] < arr[maxIndex]) {
 				// swap these and continue
@@ -172,6 +268,7 @@ private:
 		} while (true);
 
 	}
+
 };
 
 
@@ -0,0 +1,209 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <utility>
+#include <cstddef>
+
+/*
+	Indexed (addressable) priority queue: a binary min heap (with respect to less, like the CLRS priority queue for Dijkstra and Prim)
+	where every key belongs to a handle, an integer the caller picks (a vertex id, an event id...)
+	Heap cannot change a key once it is pushed, so shortest path code pushes a vertex again every time its distance drops
+	and the heap fills up with stale copies. Here we keep a map from handle to its slot in the heap array,
+	so we can find a key in O(1) and change or remove it with one sift in O(log(n))
+	The keys live in the heap array next to their handles (so sifts compare without jumping to another array),
+	and the position map is a flat vector indexed by handle. Nothing is allocated per operation
+	(only when a handle beyond the capacity shows up, and reserve avoids that too)
+	Order: the top is the SMALLEST key with respect to less (std::greater<T> makes it a max heap). Heap, DaryHeap, TopK and MultiQueue
+	go the other way, with the largest with respect to cmp on top, which is why the comparator has a different name here
+*/
+template<typename T, class Less = std::less<T>>
+class IndexedHeap {
+public:
+	static const size_t NOT_IN_HEAP = (size_t)-1;
+
+	// handles from 0 to capacity-1 can be used without the position map growing
+	IndexedHeap(size_t capacity = 0, Less less = Less()) {
+		this->less = less;
+		reserve(capacity);
+	}
+
+	void reserve(size_t capacity) {
+		if (capacity > position.size()) position.resize(capacity, NOT_IN_HEAP);
+		heap.reserve(capacity);
+	}
+
+	size_t size() const {
+		return heap.size();
+	}
+
+	bool empty() const {
+		return heap.empty();
+	}
+
+	bool contains(size_t handle) const {
+		return handle < position.size() && position[handle] != NOT_IN_HEAP;
+	}
+
+	// current key of a handle in the heap
+	const T& key(size_t handle) const {
+		if (!contains(handle)) {
+			throw "Handle is not in the heap!";
+		}
+		return heap[position[handle]].key;
+	}
+
+	// handle with the minimum key
+	size_t top() const {
+		if (empty()) {
+			throw "Heap is empty!";
+		}
+		return heap[0].handle;
+	}
+
+	const T& topKey() const {
+		if (empty()) {
+			throw "Heap is empty!";
+		}
+		return heap[0].key;
+	}
+
+	void push(size_t handle, const T& key) {
+		if (contains(handle)) {
+			throw "Handle is already in the heap!";
+		}
+		if (handle >= position.size()) position.resize(handle + 1, NOT_IN_HEAP);
+		Entry entry;
+		entry.key = key;
+		entry.handle = handle;
+		heap.push_back(entry);
+		position[handle] = heap.size() - 1;
+		siftUp(heap.size() - 1);
+	}
+
+	// removes the handle with the minimum key and returns it
+	size_t pop() {
+		size_t handle = top();
+		removeAt(0);
+		return handle;
+	}
+
+	// CLRS DECREASE-KEY: the new key must not be larger than the current one, and the entry can only move up
+	void decreaseKey(size_t handle, const T& key) {
+		if (less(this->key(handle), key)) {
+			throw "New key is larger than current key!";
+		}
+		size_t slot = position[handle];
+		heap[slot].key = key;
+		siftUp(slot);
+	}
+
+	// the new key must not be smaller than the current one, and the entry can only move down
+	void increaseKey(size_t handle, const T& key) {
+		if (less(key, this->key(handle))) {
+			throw "New key is smaller than current key!";
+		}
+		size_t slot = position[handle];
+		heap[slot].key = key;
+		siftDown(slot);
+	}
+
+	// sets the key in either direction, and pushes the handle if it is not in the heap yet
+	void pushOrUpdate(size_t handle, const T& key) {
+		if (!contains(handle)) {
+			push(handle, key);
+			return;
+		}
+		size_t slot = position[handle];
+		bool smaller = less(key, heap[slot].key);
+		heap[slot].key = key;
+		if (smaller) siftUp(slot);
+		else siftDown(slot);
+	}
+
+	void erase(size_t handle) {
+		if (!contains(handle)) {
+			throw "Handle is not in the heap!";
+		}
+		removeAt(position[handle]);
+	}
+
+	void clear() {
+		for (size_t i = 0; i < heap.size(); i++) {
+			position[heap[i].handle] = NOT_IN_HEAP;
+		}
+		heap.clear();
+	}
+
+	// this function is just a sanity check to verify that the heap invariant and the position map are maintained
+	bool verifyHeap() const {
+		for (size_t i = 0; i < heap.size(); i++) {
+			if (position[heap[i].handle] != i) return false;
+			if (i > 0 && less(heap[i].key, heap[(i - 1) / 2].key)) return false;
+		}
+		return true;
+	}
+
+private:
+	struct Entry {
+		T key;
+		size_t handle;
+	};
+
+	Less less;
+	std::vector<Entry> heap;
+	// position[handle] is the slot of handle in heap, or NOT_IN_HEAP
+	std::vector<size_t> position;
+
+	// moves entry into slot and records the new slot of its handle
+	void place(size_t slot, Entry&& entry) {
+		position[entry.handle] = slot;
+		heap[slot] = std::move(entry);
+	}
+
+	// sift up moving a hole instead of swapping, every entry that moves gets its position updated
+	void siftUp(size_t slot) {
+		Entry entry = std::move(heap[slot]);
+		while (slot > 0) {
+			size_t parent = (slot - 1) / 2;
+			if (!less(entry.key, heap[parent].key)) break;
+			place(slot, std::move(heap[parent]));
+			slot = parent;
+		}
+		place(slot, std::move(entry));
+	}
+
+	void siftDown(size_t slot) {
+		Entry entry = std::move(heap[slot]);
+		size_t n = heap.size();
+		while (true) {
+			size_t child = 2 * slot + 1;
+			if (child >= n) break;
+			if (child + 1 < n && less(heap[child + 1].key, heap[child].key)) child++;
+			if (!less(heap[child].key, entry.key)) break;
+			place(slot, std::move(heap[child]));
+			slot = child;
+		}
+		place(slot, std::move(entry));
+	}
+
+	// removes the entry at slot: the last entry takes its place and moves up or down from there
+	void removeAt(size_t slot) {
+		position[heap[slot].handle] = NOT_IN_HEAP;
+		size_t last = heap.size() - 1;
+		if (slot != last) {
+			bool smaller = less(heap[last].key, heap[slot].key);
+			heap[slot] = std::move(heap[last]);
+			position[heap[slot].handle] = slot;
+			heap.pop_back();
+			if (smaller) siftUp(slot);
+			else siftDown(slot);
+		}
+		else {
+			heap.pop_back();
+		}
+	}
+};
+
+// definition for the static constant, since vector::resize takes it by reference
+template<typename T, class Less>
+const size_t IndexedHeap<T, Less>::NOT_IN_HEAP;
@@ -0,0 +1,165 @@
+#pragma once
+#include "DaryHeap.cpp"
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+/*
+	MultiQueue (Rihani, Sanders and Dementiev): a relaxed concurrent priority queue for many threads
+	One heap behind one mutex serializes every push and pop. Instead we keep several sequential heaps (DaryHeaps),
+	each behind its own lock that we only ever try_lock (a thread that finds a lock taken just picks another heap, nobody waits)
+		push goes into a random heap
+		pop looks at two random heaps and takes the top of the better one (the power of two choices)
+	The price is that pop does not always return THE top, but one close to it. The rank error of a pop is how many elements
+	in the queue are better than the one it returned, and with two choices its expected value grows linearly with the number
+	of heaps m (Alistarh et al. show it is O(m), and it comes out a little under m in MultiQueueBenchmark)
+	So the constructor takes the rank error bound and uses that many heaps. This bounds the EXPECTED rank error, averaged over pops,
+	not every single pop: single pops can be several times worse
+	A bound below the number of threads means fewer heaps than threads, which still works but the threads fight over the locks
+	Like Heap and DaryHeap it is a max queue with respect to cmp (std::greater gives a min queue)
+*/
+template<typename T, class Compare = std::less<T>>
+class MultiQueue {
+public:
+	/*
+		numThreads of 0 means every hardware thread
+		maxRankError is the bound on the expected rank error of a pop, 0 means 2 heaps per thread (the usual choice, a bound of 2*numThreads)
+	*/
+	MultiQueue(unsigned numThreads = 0, size_t maxRankError = 0, Compare cmp = Compare()) : queues(queueCount(numThreads, maxRankError)) {
+		this->cmp = cmp;
+		for (size_t i = 0; i < queues.size(); i++) {
+			queues[i].heap = Heap4(cmp);
+		}
+		count = 0;
+	}
+
+	// the bound on the expected rank error of a pop that the number of heaps was picked for (at least 2, two choice needs two heaps)
+	size_t maxRankError() const {
+		return queues.size();
+	}
+
+	size_t numQueues() const {
+		return queues.size();
+	}
+
+	// number of elements over all heaps (only exact while nobody is pushing or popping)
+	size_t size() const {
+		return count.load(std::memory_order_relaxed);
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	void push(const T& value) {
+		while (true) {
+			Queue& queue = queues[randomQueue()];
+			if (!queue.lock.try_lock()) continue;
+			queue.heap.push(value);
+			count.fetch_add(1, std::memory_order_relaxed);
+			queue.lock.unlock();
+			return;
+		}
+	}
+
+	/*
+		Two choice pop: returns false only when every heap was empty at the moment we looked at it
+		If we keep drawing empty heaps (the queue is close to empty), we stop guessing and walk through all the heaps
+	*/
+	bool tryPop(T& result) {
+		const int maxEmptyTries = 4;
+		int emptyTries = 0;
+		while (emptyTries < maxEmptyTries) {
+			size_t first = randomQueue();
+			size_t second = randomQueue();
+			if (first == second) continue;
+			Queue& a = queues[first];
+			if (!a.lock.try_lock()) continue;
+			Queue& b = queues[second];
+			if (!b.lock.try_lock()) {
+				a.lock.unlock();
+				continue;
+			}
+
+			Queue* better = nullptr;
+			if (!a.heap.empty() && !b.heap.empty()) {
+				better = cmp(a.heap.top(), b.heap.top()) ? &b : &a;
+			}
+			else if (!a.heap.empty()) {
+				better = &a;
+			}
+			else if (!b.heap.empty()) {
+				better = &b;
+			}
+			if (better != nullptr) {
+				result = better->heap.pop();
+				count.fetch_sub(1, std::memory_order_relaxed);
+			}
+			b.lock.unlock();
+			a.lock.unlock();
+			if (better != nullptr) return true;
+			emptyTries++;
+		}
+
+		// scanning every heap, starting at a random one so the threads do not all line up behind heap 0
+		size_t start = randomQueue();
+		for (size_t i = 0; i < queues.size(); i++) {
+			Queue& queue = queues[(start + i) % queues.size()];
+			std::lock_guard<std::mutex> guard(queue.lock);
+			if (!queue.heap.empty()) {
+				result = queue.heap.pop();
+				count.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// pop for when we know the queue is not empty, throws like Heap if it is
+	T pop() {
+		T result;
+		if (!tryPop(result)) {
+			throw "Heap is empty!";
+		}
+		return result;
+	}
+
+private:
+	typedef DaryHeap<T, 4, Compare> Heap4;
+
+	// every heap gets its own cache lines, so two threads working on neighbouring heaps do not bounce a line between them
+	struct alignas(CACHE_LINE_SIZE) Queue {
+		std::mutex lock;
+		Heap4 heap;
+	};
+
+	Compare cmp;
+	std::vector<Queue, CacheAlignedAllocator<Queue>> queues;
+	std::atomic<size_t> count;
+
+	static size_t queueCount(unsigned numThreads, size_t maxRankError) {
+		if (maxRankError == 0) {
+			if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+			maxRankError = 2 * (size_t)numThreads;
+		}
+		// two choice needs at least two heaps
+		return std::max<size_t>(2, maxRankError);
+	}
+
+	// xorshift per thread, seeded from the thread id so every thread draws a different sequence
+	size_t randomQueue() {
+		static thread_local uint64_t state = 0;
+		if (state == 0) {
+			state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+		}
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return (size_t)(state % queues.size());
+	}
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+/*
+	Pool of nodes for the pointer based heaps (PairingHeap, FibonacciHeap)
+	Allocating every node with new makes push an allocator call and scatters the nodes all over memory.
+	Instead we allocate nodes in blocks of NODE_POOL_BLOCK_SIZE and recycle released nodes through a free list
+	Nodes never move (blocks are never reallocated), so a Node* stays valid as a handle until the node is released
+	splice moves all the blocks of another pool into this one in O(number of blocks), which is what lets the heaps meld
+	without copying nodes: the handles into the other heap stay valid and now belong to this pool
+*/
+const size_t NODE_POOL_BLOCK_SIZE = 256;
+
+template<typename Node>
+class NodePool {
+public:
+	NodePool() {
+		used = NODE_POOL_BLOCK_SIZE;
+	}
+
+	// node from the free list, or the next unused node of the current block (the node's fields are left as they were)
+	Node* allocate() {
+		if (!freeList.empty()) {
+			Node* node = freeList.back();
+			freeList.pop_back();
+			return node;
+		}
+		if (used == NODE_POOL_BLOCK_SIZE) {
+			blocks.push_back(std::unique_ptr<Node[]>(new Node[NODE_POOL_BLOCK_SIZE]));
+			used = 0;
+		}
+		Node* node = &blocks.back()[used];
+		used++;
+		return node;
+	}
+
+	void release(Node* node) {
+		freeList.push_back(node);
+	}
+
+	// takes over every node of other (in use or free), other ends up empty
+	void splice(NodePool& other) {
+		if (other.blocks.empty()) return;
+		// the unused tail of our current block goes to the free list, since the current block is about to change
+		for (; used < NODE_POOL_BLOCK_SIZE && !blocks.empty(); used++) {
+			freeList.push_back(&blocks.back()[used]);
+		}
+		for (size_t i = 0; i < other.blocks.size(); i++) {
+			blocks.push_back(std::move(other.blocks[i]));
+		}
+		freeList.insert(freeList.end(), other.freeList.begin(), other.freeList.end());
+		used = other.used;
+		other.blocks.clear();
+		other.freeList.clear();
+		other.used = NODE_POOL_BLOCK_SIZE;
+	}
+
+	// releases every node at once
+	void clear() {
+		blocks.clear();
+		freeList.clear();
+		used = NODE_POOL_BLOCK_SIZE;
+	}
+
+private:
+	std::vector<std::unique_ptr<Node[]>> blocks;
+	std::vector<Node*> freeList;
+	// number of nodes handed out from the last block
+	size_t used;
+};
@@ -0,0 +1,170 @@
+#pragma once
+#include "NodePool.cpp"
+#include <functional>
+#include <utility>
+#include <cstddef>
+
+/*
+	Pairing heap (Fredman, Sedgewick, Sleator and Tarjan): a min heap (with respect to less) stored as a heap ordered multiway tree
+	It is the simple cousin of the Fibonacci heap: push, meld and decreaseKey just link two trees (one comparison, O(1)),
+	and all the work is put off until pop, which pairs up the root's children left to right and then melds the pairs right to left
+	pop is O(log(n)) amortized, decreaseKey is o(log(n)) amortized (O(1) in practice), and the constants are much smaller
+	than the Fibonacci heap's, which is why it is usually the faster of the two
+	Every tree node keeps its first child, its next sibling, and prev (its previous sibling, or its parent if it is the first child)
+	Same interface as FibonacciHeap: push returns a Handle (a node pointer) that decreaseKey takes, and the handle stays valid until
+	its node is popped, also after a meld
+	Order: top is the smallest key with respect to less, like IndexedHeap and FibonacciHeap (and unlike the cmp max heaps such as DaryHeap)
+*/
+template<typename T, class Less = std::less<T>>
+class PairingHeap {
+public:
+	struct Node {
+		T key;
+		Node* child;
+		Node* next;
+		Node* prev;
+	};
+	typedef Node* Handle;
+
+	PairingHeap(Less less = Less()) {
+		this->less = less;
+		root = nullptr;
+		count = 0;
+	}
+
+	// the nodes belong to the pool, so a heap cannot be copied (it can be melded into another one)
+	PairingHeap(const PairingHeap&) = delete;
+	PairingHeap& operator=(const PairingHeap&) = delete;
+
+	size_t size() const {
+		return count;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	Handle push(const T& key) {
+		Node* node = pool.allocate();
+		node->key = key;
+		node->child = nullptr;
+		node->next = nullptr;
+		node->prev = nullptr;
+		root = link(root, node);
+		count++;
+		return node;
+	}
+
+	// return the current minimum of the heap without removing it
+	const T& top() const {
+		if (empty()) {
+			throw "Heap is empty!";
+		}
+		return root->key;
+	}
+
+	// return the current minimum of the heap and remove it (handles to it are invalid afterwards)
+	T pop() {
+		if (empty()) {
+			throw "Heap is empty!";
+		}
+		Node* oldRoot = root;
+		T result = std::move(oldRoot->key);
+		root = combineSiblings(oldRoot->child);
+		if (root != nullptr) root->prev = nullptr;
+		pool.release(oldRoot);
+		count--;
+		return result;
+	}
+
+	// the key of a handle that is still in the heap
+	const T& key(Handle node) const {
+		return node->key;
+	}
+
+	// the new key must not be larger than the current one: we cut the node's subtree out and link it with the root
+	void decreaseKey(Handle node, const T& key) {
+		if (less(node->key, key)) {
+			throw "New key is larger than current key!";
+		}
+		node->key = key;
+		if (node == root) return;
+		// unlinking node from its list of siblings
+		if (node->prev->child == node) {
+			node->prev->child = node->next;
+		}
+		else {
+			node->prev->next = node->next;
+		}
+		if (node->next != nullptr) node->next->prev = node->prev;
+		node->next = nullptr;
+		node->prev = nullptr;
+		root = link(root, node);
+	}
+
+	// moves every element of other into this heap in O(1) (plus splicing the node pools), other ends up empty
+	void meld(PairingHeap& other) {
+		if (&other == this) return;
+		root = link(root, other.root);
+		count += other.count;
+		pool.splice(other.pool);
+		other.root = nullptr;
+		other.count = 0;
+	}
+
+	void clear() {
+		pool.clear();
+		root = nullptr;
+		count = 0;
+	}
+
+private:
+	Less less;
+	Node* root;
+	size_t count;
+	NodePool<Node> pool;
+
+	// links two roots (either may be null): the larger one becomes the first child of the smaller one
+	Node* link(Node* a, Node* b) {
+		if (a == nullptr) return b;
+		if (b == nullptr) return a;
+		if (less(b->key, a->key)) std::swap(a, b);
+		b->next = a->child;
+		if (a->child != nullptr) a->child->prev = b;
+		b->prev = a;
+		a->child = b;
+		return a;
+	}
+
+	/*
+		Two pass pairing of a list of siblings into one tree, without recursion or extra memory:
+		the first pass links neighbours in pairs from left to right and chains the results in reverse order through next,
+		so the second pass can walk that chain and meld the pairs from right to left
+	*/
+	Node* combineSiblings(Node* first) {
+		Node* paired = nullptr;
+		while (first != nullptr) {
+			Node* a = first;
+			Node* b = a->next;
+			first = b != nullptr ? b->next : nullptr;
+			a->next = nullptr;
+			a->prev = nullptr;
+			if (b != nullptr) {
+				b->next = nullptr;
+				b->prev = nullptr;
+			}
+			Node* tree = link(a, b);
+			tree->next = paired;
+			paired = tree;
+		}
+
+		Node* result = nullptr;
+		while (paired != nullptr) {
+			Node* next = paired->next;
+			paired->next = nullptr;
+			result = link(result, paired);
+			paired = next;
+		}
+		return result;
+	}
+};
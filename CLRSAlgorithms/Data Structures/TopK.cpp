@@ -0,0 +1,125 @@
+#pragma once
+#include "Heap.cpp"
+#include <vector>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <cstddef>
+
+/*
+	Streaming top k: keeps the k largest items (with respect to cmp) out of a stream of any length in O(k) memory
+	The trick is to keep the k items in a heap whose root is the SMALLEST of them (a max heap with respect to the reversed comparator)
+	Then the root is the bar that a new item has to clear: most items of a long stream are below it
+	and get rejected with a single comparison, and the ones that clear it replace the root and sift down in O(log(k))
+	So a stream of n items costs O(n + m*log(k)) where m is the number of items that made it in at some point
+	Partial results from different threads (each thread keeps its own TopK over its part of the stream) are combined with merge
+*/
+
+template<typename T, class Compare = std::less<T>>
+class TopK {
+public:
+	// a max heap with respect to this comparator has the smallest item (with respect to cmp) at the root
+	struct Reversed {
+		Compare cmp;
+		bool operator()(const T& a, const T& b) const {
+			return cmp(b, a);
+		}
+	};
+
+	TopK(size_t k, Compare cmp = Compare()) {
+		this->k = k;
+		this->cmp = cmp;
+		this->reversed.cmp = cmp;
+		items.reserve(k);
+	}
+
+	// offers an item to the top k, returns whether it was kept
+	bool push(const T& item) {
+		if (items.size() < k) {
+			items.push_back(item);
+			Heap::siftUp(items.begin(), (std::ptrdiff_t)items.size() - 1, reversed);
+			return true;
+		}
+		// the one comparison most items stop at
+		if (k == 0 || !cmp(items.front(), item)) return false;
+		items.front() = item;
+		Heap::siftDown(items.begin(), 0, (std::ptrdiff_t)items.size(), reversed);
+		return true;
+	}
+
+	template<class InputIterator>
+	void push(InputIterator first, InputIterator last) {
+		for (; first != last; first++) {
+			push(*first);
+		}
+	}
+
+	// folds the items of another top k (usually another thread's) into this one
+	void merge(const TopK& other) {
+		push(other.items.begin(), other.items.end());
+	}
+
+	// the smallest item that is currently in the top k (the bar a new item has to clear once we hold k items)
+	const T& top() const {
+		if (items.empty()) {
+			throw "TopK is empty!";
+		}
+		return items.front();
+	}
+
+	size_t size() const {
+		return items.size();
+	}
+
+	bool full() const {
+		return items.size() == k;
+	}
+
+	// the items we kept, largest first (the top k stays intact)
+	std::vector<T> sorted() const {
+		std::vector<T> result = items;
+		Heap::sortHeap(result.begin(), result.end(), reversed);
+		return result;
+	}
+
+	// same as sorted, but hands over our items instead of copying them and leaves the top k empty
+	std::vector<T> extract() {
+		std::vector<T> result;
+		result.swap(items);
+		Heap::sortHeap(result.begin(), result.end(), reversed);
+		return result;
+	}
+
+private:
+	size_t k;
+	Compare cmp;
+	Reversed reversed;
+	// a max heap with respect to reversed
+	std::vector<T> items;
+};
+
+/*
+	Partial sort: rearranges the range so [first, middle) holds the (middle - first) smallest elements in ascending order
+	(the order of [middle, last) is unspecified), like std::partial_sort
+	This is the bounded heap of TopK run in place: [first, middle) is the heap (a max heap with respect to cmp, so the root
+	is the largest of the smallest elements seen so far) and every element of [middle, last) gets compared against the root
+	Runs in O(n*log(k)) time in the worst case for k = middle - first, and close to O(n) when few elements make it into the heap
+*/
+template<class RandomAccessIterator, class Compare>
+void partialSort(RandomAccessIterator first, RandomAccessIterator middle, RandomAccessIterator last, Compare cmp) {
+	std::ptrdiff_t k = middle - first;
+	if (k == 0) return;
+	Heap::makeHeap(first, middle, cmp);
+	for (RandomAccessIterator i = middle; i != last; i++) {
+		if (cmp(*i, *first)) {
+			std::iter_swap(i, first);
+			Heap::siftDown(first, 0, k, cmp);
+		}
+	}
+	Heap::sortHeap(first, middle, cmp);
+}
+
+template<class RandomAccessIterator>
+void partialSort(RandomAccessIterator first, RandomAccessIterator middle, RandomAccessIterator last) {
+	partialSort(first, middle, last, std::less<typename std::iterator_traits<RandomAccessIterator>::value_type>());
+}
@@ -0,0 +1,342 @@
+#pragma once
+#include "QuickSelect.cpp"
+#include <vector>
+#include <random>
+#include <functional>
+#include <type_traits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/*
+	KLL quantile sketch (Karnin, Lang and Liberty): approximate quantiles of a stream of any length in bounded memory
+	Exact selection (quickselect, introselect) needs all n items in memory. The sketch keeps O(k) of them instead, where every kept item
+	stands in for 2^h stream items if it sits at level h
+	Level h is a compactor with a capacity that shrinks by a factor 2/3 per level below the top one. When the sketch gets full,
+	we take the lowest full compactor, sort it, and promote every other item (starting at a random offset) to the next level up
+	with twice the weight, throwing away the rest. The random offset keeps the rank estimates unbiased, and since the lower
+	(cheaper) levels are the small ones, the rank error is about 1.3% for k = 200 and drops roughly like 1/k
+	As long as nothing was ever compacted (fewer than about k items) the sketch is exact
+	Sketches with the same k can be merged (one per thread, or partial sketches loaded back with fromBytes),
+	and the merged sketch has the same error guarantee as one sketch that saw both streams
+*/
+template<typename T, class Compare = std::less<T>>
+class KllSketch {
+public:
+	// the default k, about 1.3% rank error
+	static const uint32_t DEFAULT_K = 200;
+
+	KllSketch(uint32_t k = DEFAULT_K, uint64_t seed = 5489, Compare cmp = Compare()) : generator(seed) {
+		if (k < 2) {
+			throw "KLL sketch needs k of at least 2!";
+		}
+		this->k = k;
+		this->cmp = cmp;
+		n = 0;
+		size = 0;
+		levels.push_back(std::vector<T>());
+		maxSize = levelCapacity(0);
+	}
+
+	/*
+		Smallest k whose normalized rank error is at most epsilon (with 99% confidence)
+		Uses the empirical fit epsilon = 2.296 / k^0.9723 that the DataSketches library publishes for the KLL sketch
+	*/
+	static uint32_t kForError(double epsilon) {
+		if (!(epsilon > 0 && epsilon < 1)) {
+			throw "Unexpected: the error target has to be between 0 and 1!";
+		}
+		double k = std::ceil(std::pow(2.296 / epsilon, 1 / 0.9723));
+		return (uint32_t)std::max(2.0, std::min(k, 1e9));
+	}
+
+	// the normalized rank error this sketch is expected to stay within (inverse of kForError)
+	double normalizedRankError() const {
+		return 2.296 / std::pow((double)k, 0.9723);
+	}
+
+	// adds one item of the stream, amortized O(1) (compaction only happens when the sketch is full)
+	void update(const T& item) {
+		if (n == 0 || cmp(item, minimum)) minimum = item;
+		if (n == 0 || cmp(maximum, item)) maximum = item;
+		levels[0].push_back(item);
+		n++;
+		size++;
+		if (size >= maxSize) compress();
+	}
+
+	// folds another sketch (with the same k) into this one
+	void merge(const KllSketch& other) {
+		if (other.k != k) {
+			throw "Only sketches with the same k can be merged!";
+		}
+		if (other.n == 0) return;
+		if (n == 0 || cmp(other.minimum, minimum)) minimum = other.minimum;
+		if (n == 0 || cmp(maximum, other.maximum)) maximum = other.maximum;
+		while (levels.size() < other.levels.size()) grow();
+		for (size_t h = 0; h < other.levels.size(); h++) {
+			levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+			size += other.levels[h].size();
+		}
+		n += other.n;
+		while (size >= maxSize) compress();
+	}
+
+	// number of stream items the sketch has seen
+	uint64_t count() const {
+		return n;
+	}
+
+	// number of items the sketch actually keeps
+	size_t retained() const {
+		return size;
+	}
+
+	// true while the answers are exact (nothing was compacted yet)
+	bool exact() const {
+		return levels.size() == 1;
+	}
+
+	/*
+		Approximate q-quantile for q in [0, 1]: the item of rank floor(q*(n-1)) (0 based, the lower one, like selectQuantiles)
+		0 and 1 give the exact minimum and maximum
+	*/
+	T quantile(double q) const {
+		if (n == 0) {
+			throw "Sketch is empty! There are no quantiles!";
+		}
+		if (!(q >= 0 && q <= 1)) {
+			throw "Unexpected: quantiles have to be between 0 and 1!";
+		}
+		return quantileOf(weightedItems(), q);
+	}
+
+	// quantiles for several q at once, sorting the kept items only once
+	std::vector<T> quantiles(const std::vector<double>& qs) const {
+		if (n == 0) {
+			throw "Sketch is empty! There are no quantiles!";
+		}
+		std::vector<std::pair<T, uint64_t>> items = weightedItems();
+		std::vector<T> result;
+		for (size_t i = 0; i < qs.size(); i++) {
+			if (!(qs[i] >= 0 && qs[i] <= 1)) {
+				throw "Unexpected: quantiles have to be between 0 and 1!";
+			}
+			result.push_back(quantileOf(items, qs[i]));
+		}
+		return result;
+	}
+
+	// approximate number of stream items that are less than item
+	uint64_t rank(const T& item) const {
+		uint64_t result = 0;
+		for (size_t h = 0; h < levels.size(); h++) {
+			for (size_t i = 0; i < levels[h].size(); i++) {
+				if (cmp(levels[h][i], item)) result += (uint64_t)1 << h;
+			}
+		}
+		return result;
+	}
+
+	/*
+		Serializes the sketch into bytes so partial sketches can be stored or shipped and merged later
+		Layout: k, n, number of levels, minimum, maximum, then every level as its size followed by its items
+		Items are copied byte for byte, so T has to be trivially copyable and the reader has to have the same endianness
+	*/
+	std::vector<unsigned char> toBytes() const {
+		static_assert(std::is_trivially_copyable<T>::value, "KLL sketch serialization needs a trivially copyable item type");
+		std::vector<unsigned char> bytes;
+		appendBytes(bytes, SERIALIZATION_MAGIC);
+		appendBytes(bytes, k);
+		appendBytes(bytes, n);
+		appendBytes(bytes, (uint32_t)levels.size());
+		appendBytes(bytes, n == 0 ? T() : minimum);
+		appendBytes(bytes, n == 0 ? T() : maximum);
+		for (size_t h = 0; h < levels.size(); h++) {
+			appendBytes(bytes, (uint64_t)levels[h].size());
+			for (size_t i = 0; i < levels[h].size(); i++) {
+				appendBytes(bytes, levels[h][i]);
+			}
+		}
+		return bytes;
+	}
+
+	// rebuilds a sketch from toBytes (the random generator starts over from seed)
+	static KllSketch fromBytes(const std::vector<unsigned char>& bytes, uint64_t seed = 5489, Compare cmp = Compare()) {
+		size_t offset = 0;
+		if (readBytes<uint32_t>(bytes, offset) != SERIALIZATION_MAGIC) {
+			throw "Not a serialized KLL sketch!";
+		}
+		uint32_t k = readBytes<uint32_t>(bytes, offset);
+		KllSketch sketch = KllSketch(k, seed, cmp);
+		sketch.n = readBytes<uint64_t>(bytes, offset);
+		uint32_t numLevels = readBytes<uint32_t>(bytes, offset);
+		if (numLevels == 0 || numLevels > 64) {
+			throw "Corrupt KLL sketch: bad number of levels!";
+		}
+		sketch.minimum = readBytes<T>(bytes, offset);
+		sketch.maximum = readBytes<T>(bytes, offset);
+		while (sketch.levels.size() < numLevels) sketch.grow();
+		uint64_t weight = 0;
+		for (uint32_t h = 0; h < numLevels; h++) {
+			uint64_t levelSize = readBytes<uint64_t>(bytes, offset);
+			if (levelSize > (bytes.size() - offset) / sizeof(T)) {
+				throw "Corrupt KLL sketch: level is larger than the data!";
+			}
+			for (uint64_t i = 0; i < levelSize; i++) {
+				sketch.levels[h].push_back(readBytes<T>(bytes, offset));
+			}
+			sketch.size += levelSize;
+			weight += levelSize << h;
+		}
+		if (offset != bytes.size() || weight != sketch.n) {
+			throw "Corrupt KLL sketch: sizes do not add up!";
+		}
+		return sketch;
+	}
+
+private:
+	static const uint32_t SERIALIZATION_MAGIC = 0x4b4c4c31;
+
+	uint32_t k;
+	Compare cmp;
+	std::mt19937_64 generator;
+	// number of stream items seen
+	uint64_t n;
+	// number of items kept over all levels, and the limit that triggers a compaction
+	size_t size;
+	size_t maxSize;
+	// levels[h] is the compactor at height h, its items stand in for 2^h stream items each
+	std::vector<std::vector<T>> levels;
+	T minimum;
+	T maximum;
+
+	// capacity of level h: k at the top level, shrinking by 2/3 per level below it (never below 2)
+	size_t levelCapacity(size_t h) const {
+		size_t depth = levels.size() - h - 1;
+		return (size_t)std::ceil(std::pow(2.0 / 3.0, (double)depth) * k) + 1;
+	}
+
+	// adds a level on top, which shrinks the capacities of all the levels below
+	void grow() {
+		levels.push_back(std::vector<T>());
+		maxSize = 0;
+		for (size_t h = 0; h < levels.size(); h++) {
+			maxSize += levelCapacity(h);
+		}
+	}
+
+	// compacts the lowest full level into the one above it
+	void compress() {
+		for (size_t h = 0; h < levels.size(); h++) {
+			if (levels[h].size() < levelCapacity(h)) continue;
+			if (h + 1 == levels.size()) grow();
+
+			std::vector<T>& level = levels[h];
+			introsort(level.begin(), level.end(), cmp);
+			// with an odd number of items the largest one stays behind, so every promoted pair covers exactly two items
+			bool odd = level.size() % 2 == 1;
+			size_t pairs = level.size() / 2;
+			size_t offset = generator() & 1;
+			std::vector<T>& above = levels[h + 1];
+			for (size_t i = 0; i < pairs; i++) {
+				above.push_back(level[2 * i + offset]);
+			}
+			if (odd) {
+				level[0] = level.back();
+				level.resize(1);
+			}
+			else {
+				level.clear();
+			}
+			size -= pairs;
+			return;
+		}
+	}
+
+	// all kept items in sorted order together with their weights
+	std::vector<std::pair<T, uint64_t>> weightedItems() const {
+		std::vector<std::pair<T, uint64_t>> items;
+		items.reserve(size);
+		for (size_t h = 0; h < levels.size(); h++) {
+			for (size_t i = 0; i < levels[h].size(); i++) {
+				items.push_back(std::make_pair(levels[h][i], (uint64_t)1 << h));
+			}
+		}
+		Compare compare = cmp;
+		introsort(items.begin(), items.end(), [&compare](const std::pair<T, uint64_t>& a, const std::pair<T, uint64_t>& b) {
+			return compare(a.first, b.first);
+		});
+		return items;
+	}
+
+	// walks the sorted weighted items up to rank floor(q*(n-1))
+	T quantileOf(const std::vector<std::pair<T, uint64_t>>& items, double q) const {
+		if (q == 0) return minimum;
+		if (q == 1) return maximum;
+		uint64_t target = (uint64_t)(q * (n - 1));
+		uint64_t cumulative = 0;
+		for (size_t i = 0; i < items.size(); i++) {
+			cumulative += items[i].second;
+			if (cumulative > target) return items[i].first;
+		}
+		return maximum;
+	}
+
+	template<typename V>
+	static void appendBytes(std::vector<unsigned char>& bytes, V value) {
+		size_t offset = bytes.size();
+		bytes.resize(offset + sizeof(V));
+		std::memcpy(&bytes[offset], &value, sizeof(V));
+	}
+
+	template<typename V>
+	static V readBytes(const std::vector<unsigned char>& bytes, size_t& offset) {
+		if (bytes.size() - offset < sizeof(V)) {
+			throw "Corrupt KLL sketch: data ends too early!";
+		}
+		V value;
+		std::memcpy(&value, &bytes[offset], sizeof(V));
+		offset += sizeof(V);
+		return value;
+	}
+};
+
+/*
+	Self check of the exact mode: with k > n nothing is ever compacted, so a sketch of the whole input, the merge of sketches of its
+	two halves and that merge sent through toBytes and fromBytes all have to be exact, and every quantile has to be the item
+	introselect puts at rank floor(q*(n-1)) of a copy of the input
+*/
+template<typename T>
+bool verifyExactQuantiles(const std::vector<T>& arr, const std::vector<double>& qs) {
+	if (arr.size() == 0) return true;
+	uint32_t k = (uint32_t)arr.size() + 1;
+	KllSketch<T> whole(k);
+	KllSketch<T> merged(k);
+	KllSketch<T> secondHalf(k, 1);
+	for (size_t i = 0; i < arr.size(); i++) {
+		whole.update(arr[i]);
+		if (i < arr.size() / 2) merged.update(arr[i]);
+		else secondHalf.update(arr[i]);
+	}
+	merged.merge(secondHalf);
+	KllSketch<T> restored = KllSketch<T>::fromBytes(merged.toBytes());
+	if (!whole.exact() || !merged.exact() || !restored.exact()) {
+		return false;
+	}
+	if (whole.count() != arr.size() || merged.count() != arr.size() || restored.count() != arr.size()) {
+		return false;
+	}
+
+	std::vector<T> restoredQuantiles = restored.quantiles(qs);
+	std::vector<T> copy = arr;
+	for (size_t i = 0; i < qs.size(); i++) {
+		typename std::vector<T>::iterator nth = copy.begin() + (size_t)(qs[i] * (arr.size() - 1));
+		introselect(copy.begin(), nth, copy.end());
+		if (whole.quantile(qs[i]) != *nth || merged.quantile(qs[i]) != *nth || restoredQuantiles[i] != *nth) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -1,7 +1,14 @@
-#include "QuickSort.cpp"
-#include "InsertionSort.cpp"
+#pragma once
+#include "../Sorting/QuickSort.cpp"
+#include "../Sorting/InsertionSort.cpp"
+#include "../Sorting/Introsort.cpp"
 #include <functional>
 #include <vector>
+#include <iterator>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <cstddef>
 
 
 
@@ -12,26 +19,26 @@
 
 /*
 	quickselect returns the k-th smallest elements of an array, based on partition function
-	partitionFunction is the provided partition function
+	partitionFunction is the provided partition function (partition from QuickSort.cpp for example), it partitions arr in place
 	arr is the input array
 	k is the k-th smallest query, from 1 to arr.size() inclusive
 */
-int quickselect(std::vector<int> arr, int k, std::function<int(std::vector<int>,int,int)> partitionFunction) {
+int quickselect(std::vector<int> arr, int k, std::function<int(std::vector<int>&,int,int)> partitionFunction) {
 	using namespace std;
 
 	if (arr.size() == 0) {
-		throw "Array is empty! There is no k smallest element!"
+		throw "Array is empty! There is no k smallest element!";
 	}
 
-	if (k<0 || k>arr.size()) {
-		throw "Unexpected: k value is either less than zero or greater than the array size!"
+	if (k<1 || k>arr.size()) {
+		throw "Unexpected: k value is either less than one or greater than the array size!";
 	}
 	
 	int start = 0;
 	int end = arr.size() - 1;
 
 	// we will always find a k-th smallest element, so we can use a while loop instead of recursion for better performance
-	while (false) {
+	while (true) {
 		int pivotIndex = partitionFunction(arr, start, end);
 		if (pivotIndex+1 == k) {
 			return arr[pivotIndex];
@@ -47,67 +54,257 @@ int quickselect(std::vector<int> arr, int k, std::function<int(std::vector<int>,
 }
 
 /*
-	Median of Medians is a recursive function to obtain the median of medians of groups of 5 in the array
-	This is intended to be used as a partition oracle for quicksort and quickselect in worst case linear complexity
-	However, it is usually worse in practice than a randomized pivot
-	Median of Medians takes linear time
+	quickselect with a partition function that returns the whole block of elements equal to the pivot (threeWayPartition from QuickSort.cpp for example)
+	If k lands anywhere in that block we are done, so runs of equal keys never get partitioned again
+	arr is the input array
+	k is the k-th smallest query, from 1 to arr.size() inclusive
 */
-int medianOfMedians(std::vector<int> arr) {
+int quickselect(std::vector<int> arr, int k, std::function<std::pair<int,int>(std::vector<int>&,int,int)> partitionFunction) {
 	using namespace std;
 
-	// if we have a small array, directly compute the median
-	if (arr.size() < 5) {
-		insertionSort(arr);
-		return arr[arr.size() / 2];
+	if (arr.size() == 0) {
+		throw "Array is empty! There is no k smallest element!";
 	}
 
-	vector<vector<int>> groups;
-	
-	// creating groups
-	for (int i = 0; i < arr.size(); i += 5) {
-		vector<int> group;
-		for (int j = i; j < j + 5 && j<arr.size(); j += 1) {
-			group.push_back(arr[j]);
+	if (k<1 || k>arr.size()) {
+		throw "Unexpected: k value is either less than one or greater than the array size!";
+	}
+
+	int start = 0;
+	int end = arr.size() - 1;
+
+	while (true) {
+		pair<int, int> equalRange = partitionFunction(arr, start, end);
+		if (equalRange.first+1 <= k && k <= equalRange.second+1) {
+			return arr[equalRange.first];
+		}
+		else if (equalRange.second+1 < k) {
+			start = equalRange.second+1;
+		}
+		else {
+			end = equalRange.first-1;
 		}
-		groups.push_back(group);
 	}
-	
-	vector<int> medians;
+}
 
-	// insertion sorting each group and getting their medians
-	for (int i = 0; i < groups.size(); i++) {
-		insertionSort(groups[i]);
-		medians.push_back(groups[i][groups[i].size() / 2]);
+template<class RandomAccessIterator, class Compare>
+void medianOfMediansSelect(RandomAccessIterator first, RandomAccessIterator nth, RandomAccessIterator last, Compare cmp);
+
+/*
+	Median of Medians pivot, in place: we insertion sort every group of 5 and swap its median to the front of the range,
+	then select the median of those medians (which sit in the first n/5 slots) with medianOfMediansSelect
+	At least 3/10 of the range is <= the pivot and at least 3/10 is >= it, which is what makes the selection worst case linear
+	No allocations: the groups and the medians live in the range itself (the order of the range is scrambled)
+	Returns an iterator to the pivot
+*/
+template<class RandomAccessIterator, class Compare>
+RandomAccessIterator medianOfMediansPivot(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+	std::ptrdiff_t n = last - first;
+	if (n <= 5) {
+		insertionSort(first, last, cmp);
+		return first + (n - 1) / 2;
 	}
-	
-	return medianOfMedians(medians);
+	// the last partial group (if any) is left out, like in CLRS
+	std::ptrdiff_t groups = 0;
+	for (RandomAccessIterator group = first; last - group >= 5; group += 5) {
+		insertionSort(group, group + 5, cmp);
+		std::iter_swap(first + groups, group + 2);
+		groups++;
+	}
+	RandomAccessIterator median = first + groups / 2;
+	medianOfMediansSelect(first, median, first + groups, cmp);
+	return median;
 }
 
 /*
-	Helper function that uses the median of medians value of an array to acquire a pivot index
+	Worst case linear selection: rearranges [first, last) so that *nth is the element that would be there if the range was sorted,
+	everything before it is <= *nth and everything after it is >= *nth (like std::nth_element)
+	Uses the three way partition so that many equal elements cannot stall it
 */
-int medianOfMediansPartition(std::vector<int> arr, int start, int end) {
+template<class RandomAccessIterator, class Compare>
+void medianOfMediansSelect(RandomAccessIterator first, RandomAccessIterator nth, RandomAccessIterator last, Compare cmp) {
+	while (last - first > 5) {
+		RandomAccessIterator pivot = medianOfMediansPivot(first, last, cmp);
+		std::iter_swap(pivot, last - 1);
+		std::pair<RandomAccessIterator, RandomAccessIterator> equal = threeWayPartitionRange(first, last, cmp);
+		if (nth < equal.first) {
+			last = equal.first;
+		}
+		else if (nth >= equal.second) {
+			first = equal.second;
+		}
+		else {
+			return;
+		}
+	}
+	insertionSort(first, last, cmp);
+}
+
+/*
+	Median of Medians value of an array (the array is a copy, so the caller's array is left alone)
+	This is intended to be used as a partition oracle for quicksort and quickselect in worst case linear complexity
+	However, it is usually worse in practice than a randomized pivot
+	Median of Medians takes linear time
+*/
+int medianOfMedians(std::vector<int> arr) {
+	if (arr.size() == 0) {
+		throw "Array is empty! There is no median!";
+	}
+	return *medianOfMediansPivot(arr.begin(), arr.end(), std::less<int>());
+}
+
+/*
+	Partition function for quickselect (same signature as partition from QuickSort.cpp) that pivots on the median of medians
+	The pivot is found in place in arr[start..end] and then swapped to the end for partition
+*/
+int medianOfMediansPartition(std::vector<int>& arr, int start, int end) {
+	std::vector<int>::iterator pivot = medianOfMediansPivot(arr.begin() + start, arr.begin() + end + 1, std::less<int>());
+	std::iter_swap(pivot, arr.begin() + end);
+	return partition(arr, start, end);
+}
+
+// ranges with at most this many elements are finished with insertion sort
+const std::ptrdiff_t INTROSELECT_THRESHOLD = 16;
+// ranges larger than this pick their pivot with Floyd-Rivest sampling, smaller ones with the median of three
+const std::ptrdiff_t FLOYD_RIVEST_CUTOFF = 600;
+// rounds that fail to cut at least a quarter of the range before we give up and switch to median of medians
+const int INTROSELECT_MAX_STALLS = 3;
+
+/*
+	Introselect: in place selection on an iterator range, with the same contract as std::nth_element
+	(*nth ends up as the element that would be there if the range was sorted, with <= elements before it and >= elements after it)
+	Quickselect with a random pivot does about 3.4n comparisons on average. Floyd and Rivest do better by picking the pivot out of a sample:
+	we select (recursively) from a sample of about n^(2/3) elements gathered in a window around nth, offset so that the pivot lands just on the near side of nth,
+	and then nearly all of the range is cut away by a single partition. That gives about n + min(k, n-k) comparisons, so at most ~1.5n
+	Like introsort, we watch for bad luck (or adversarial input): every round that does not cut at least a quarter of the range is a stall,
+	and after INTROSELECT_MAX_STALLS of them we finish with medianOfMediansSelect, so the worst case is still O(n)
+	Nothing is allocated
+*/
+template<class RandomAccessIterator, class Compare>
+void introselect(RandomAccessIterator first, RandomAccessIterator nth, RandomAccessIterator last, Compare cmp) {
 	using namespace std;
+	if (nth >= last) return;
+	int stalls = 0;
 
-	vector<int> arrsub;
-	copy(arr.begin() + start, arr.begin() + end + 1,arrsub.begin());
+	while (last - first > INTROSELECT_THRESHOLD) {
+		if (stalls >= INTROSELECT_MAX_STALLS) {
+			medianOfMediansSelect(first, nth, last, cmp);
+			return;
+		}
+		ptrdiff_t n = last - first;
+		if (n > FLOYD_RIVEST_CUTOFF) {
+			// sample window [sampleFirst, sampleLast] around nth, after Floyd and Rivest's SELECT
+			double k = (double)(nth - first);
+			double z = log((double)n);
+			double s = 0.5 * exp(2 * z / 3);
+			double sd = 0.5 * sqrt(z * s * (n - s) / n) * (k + 1 < n / 2.0 ? -1 : 1);
+			ptrdiff_t sampleFirst = max<ptrdiff_t>(0, (ptrdiff_t)(k - (k + 1) * s / n + sd));
+			ptrdiff_t sampleLast = min<ptrdiff_t>(n - 1, (ptrdiff_t)(k + (n - k - 1) * s / n + sd));
+			// the window only works as a sample if it looks like the whole range, which is not true for partly ordered input
+			// (after an earlier selection for example), so we fill it with elements from evenly spread positions first
+			ptrdiff_t sampleSize = sampleLast - sampleFirst + 1;
+			for (ptrdiff_t j = 0; j < sampleSize; j++) {
+				iter_swap(first + sampleFirst + j, first + j * n / sampleSize);
+			}
+			introselect(first + sampleFirst, nth, first + sampleLast + 1, cmp);
+		}
+		else {
+			iter_swap(nth, medianOfThree(first, first + n / 2, last - 1, cmp));
+		}
 
-	int medianOfMediansValue = medianOfMedians(arrsub);
-	int index = -1;
-	for (int i = 0; i < arrsub.size(); i++) {
-		if (arr[i] == medianOfMediansValue) {
-			index = i;
-			break;
+		// the pivot is at nth now, and the three way partition finishes every key equal to it at once,
+		// so a run of duplicates around nth ends the selection instead of counting as a stall
+		iter_swap(nth, last - 1);
+		pair<RandomAccessIterator, RandomAccessIterator> equal = threeWayPartitionRange(first, last, cmp);
+		if (nth < equal.first) {
+			last = equal.first;
+		}
+		else if (nth >= equal.second) {
+			first = equal.second;
+		}
+		else {
+			return;
 		}
+		if (last - first > n - n / 4) stalls++;
 	}
+	insertionSort(first, last, cmp);
+}
+
+template<class RandomAccessIterator>
+void introselect(RandomAccessIterator first, RandomAccessIterator nth, RandomAccessIterator last) {
+	introselect(first, nth, last, std::less<typename std::iterator_traits<RandomAccessIterator>::value_type>());
+}
+
+/*
+	Multi selection helper: ranks[firstRank..lastRank) are sorted distinct positions inside [first, last) (relative to base)
+	We select the middle requested rank, which also partitions the range around it, and then only go into the two sides
+	with the requested ranks that fall into them
+*/
+template<class RandomAccessIterator, class Compare>
+void multiSelectRanks(RandomAccessIterator base, RandomAccessIterator first, RandomAccessIterator last, const std::vector<size_t>& ranks, size_t firstRank, size_t lastRank, Compare cmp) {
+	if (firstRank >= lastRank) return;
+	size_t middleRank = firstRank + (lastRank - firstRank) / 2;
+	RandomAccessIterator middle = base + ranks[middleRank];
+	introselect(first, middle, last, cmp);
+	multiSelectRanks(base, first, middle, ranks, firstRank, middleRank, cmp);
+	multiSelectRanks(base, middle + 1, last, ranks, middleRank + 1, lastRank, cmp);
+}
 
-	// pivoting on this index
-	int tmp = arrsub[arr.size() - 1];
-	arrsub[arr.size() - 1] = arrsub[index];
-	arrsub[index] = tmp;
+/*
+	Multi selection: puts every requested rank (0 based position, like nth in introselect) of [first, last) into its sorted position at once
+	Calling introselect once per rank costs O(q*n) for q ranks. Every introselect here also partitions its range around its rank,
+	so the ranges we recurse into get split in half (by rank count) at every level and the whole thing is O(n*log(q))
+	Between two requested ranks the elements are unordered, but they are >= the element at the lower rank and <= the one at the higher rank
+	ranks do not have to be sorted or distinct
+*/
+template<class RandomAccessIterator, class Compare>
+void multiSelect(RandomAccessIterator first, RandomAccessIterator last, std::vector<size_t> ranks, Compare cmp) {
+	using namespace std;
+	size_t n = last - first;
+	for (size_t i = 0; i < ranks.size(); i++) {
+		if (ranks[i] >= n) {
+			throw "Unexpected: rank is greater than or equal to the range size!";
+		}
+	}
+	// introsort, since there can be many ranks (selectQuantiles with lots of quantiles) and insertion sort would be O(q^2)
+	introsort(ranks.begin(), ranks.end());
+	ranks.erase(unique(ranks.begin(), ranks.end()), ranks.end());
+	multiSelectRanks(first, first, last, ranks, 0, ranks.size(), cmp);
+}
 
-	int pivotIndex = partition(arrsub, 0, arrsub.size() - 1);
-	return start + pivotIndex;
+template<class RandomAccessIterator>
+void multiSelect(RandomAccessIterator first, RandomAccessIterator last, const std::vector<size_t>& ranks) {
+	multiSelect(first, last, ranks, std::less<typename std::iterator_traits<RandomAccessIterator>::value_type>());
 }
 
+/*
+	Quantiles (for example 0.5, 0.9, 0.99, 0.999) of a range with one multiSelect, the range gets rearranged
+	Quantile q is the element at rank floor(q*(n-1)) (the lower one, we do not interpolate), and we return them in the order of quantiles
+*/
+template<class RandomAccessIterator, class Compare>
+std::vector<typename std::iterator_traits<RandomAccessIterator>::value_type> selectQuantiles(RandomAccessIterator first, RandomAccessIterator last, const std::vector<double>& quantiles, Compare cmp) {
+	using namespace std;
+	size_t n = last - first;
+	if (n == 0) {
+		throw "Array is empty! There are no quantiles!";
+	}
+	vector<size_t> ranks = vector<size_t>(quantiles.size());
+	for (size_t i = 0; i < quantiles.size(); i++) {
+		if (!(quantiles[i] >= 0 && quantiles[i] <= 1)) {
+			throw "Unexpected: quantiles have to be between 0 and 1!";
+		}
+		ranks[i] = (size_t)(quantiles[i] * (n - 1));
+	}
+	multiSelect(first, last, ranks, cmp);
 
+	vector<typename iterator_traits<RandomAccessIterator>::value_type> result;
+	for (size_t i = 0; i < ranks.size(); i++) {
+		result.push_back(*(first + ranks[i]));
+	}
+	return result;
+}
+
+template<class RandomAccessIterator>
+std::vector<typename std::iterator_traits<RandomAccessIterator>::value_type> selectQuantiles(RandomAccessIterator first, RandomAccessIterator last, const std::vector<double>& quantiles) {
+	return selectQuantiles(first, last, quantiles, std::less<typename std::iterator_traits<RandomAccessIterator>::value_type>());
+}
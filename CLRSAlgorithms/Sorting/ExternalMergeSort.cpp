@@ -0,0 +1,337 @@
+#pragma once
+#include "MergeSort.cpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+#include <queue>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+/*
+	External memory merge sort for files of fixed size binary records that do not fit in memory
+	Phase 1 (run generation): read as many records as the memory budget allows, sort them with mergeSort and write them out as a sorted run
+	Phase 2 (merging): k-way merge the runs with large sequential block reads and writes, in several passes if there are too many runs
+	Both phases overlap I/O with compute by double buffering: while we work on one buffer, a background read (or write) fills (or drains) the other
+	The sort is stable: runs are sorted stably and ties in the merge go to the run that came first in the input
+*/
+
+// preferred size of the blocks that the merge phase reads and writes at a time (smaller if the memory budget needs it)
+const size_t EXTERNAL_BLOCK_BYTES = 1 << 22;
+
+inline std::FILE* openRecordFile(const std::string& path, const char* mode) {
+	std::FILE* file = std::fopen(path.c_str(), mode);
+	if (file == nullptr) {
+		throw "Could not open file for the external sort!";
+	}
+	return file;
+}
+
+// reads up to count records and returns how many we actually got (fewer only at the end of the file)
+template<typename T>
+size_t readRecords(std::FILE* file, T* records, size_t count) {
+	size_t numRead = std::fread(records, sizeof(T), count, file);
+	if (numRead < count && std::ferror(file)) {
+		throw "Read error in the external sort!";
+	}
+	return numRead;
+}
+
+template<typename T>
+void writeRecords(std::FILE* file, const T* records, size_t count) {
+	if (std::fwrite(records, sizeof(T), count, file) != count) {
+		throw "Write error in the external sort!";
+	}
+}
+
+/*
+	Sequential reader over one sorted run with two blocks: we hand out records from one block while the next block is read in the background
+*/
+template<typename T>
+class RunReader {
+public:
+	RunReader(const std::string& path, size_t blockRecords) {
+		// the blocks come first, so a failed allocation cannot leave the file open
+		current = std::vector<T>(blockRecords);
+		next = std::vector<T>(blockRecords);
+		position = 0;
+		file = openRecordFile(path, "rb");
+		// a throwing constructor never runs the destructor, so the file is ours to close here
+		try {
+			count = readRecords(file, current.data(), blockRecords);
+			prefetch();
+		}
+		catch (...) {
+			std::fclose(file);
+			throw;
+		}
+	}
+
+	~RunReader() {
+		if (pending.valid()) pending.wait();
+		std::fclose(file);
+	}
+
+	RunReader(const RunReader&) = delete;
+	RunReader& operator=(const RunReader&) = delete;
+
+	bool empty() const {
+		return position == count;
+	}
+
+	const T& head() const {
+		return current[position];
+	}
+
+	// move on to the next record, swapping in the prefetched block once this one is used up
+	void advance() {
+		position++;
+		if (position == count && count != 0) {
+			count = pending.get();
+			std::swap(current, next);
+			position = 0;
+			prefetch();
+		}
+	}
+
+private:
+	std::FILE* file;
+	std::vector<T> current;
+	std::vector<T> next;
+	size_t position;
+	size_t count;
+	std::future<size_t> pending;
+
+	void prefetch() {
+		if (count == 0) return;
+		std::FILE* source = file;
+		T* target = next.data();
+		size_t blockRecords = next.size();
+		pending = std::async(std::launch::async, [source, target, blockRecords]() { return readRecords(source, target, blockRecords); });
+	}
+};
+
+/*
+	Sequential writer with two blocks: records are collected in one block while the other one is written in the background
+*/
+template<typename T>
+class RunWriter {
+public:
+	RunWriter(const std::string& path, size_t blockRecords) {
+		// opening the file last, so nothing after it can throw and leave it open
+		current = std::vector<T>(blockRecords);
+		next = std::vector<T>(blockRecords);
+		count = 0;
+		file = openRecordFile(path, "wb");
+	}
+
+	~RunWriter() {
+		if (pending.valid()) pending.wait();
+		if (file != nullptr) std::fclose(file);
+	}
+
+	RunWriter(const RunWriter&) = delete;
+	RunWriter& operator=(const RunWriter&) = delete;
+
+	void push(const T& record) {
+		current[count] = record;
+		count++;
+		if (count == current.size()) flush();
+	}
+
+	// writes out everything that is left and closes the file
+	void close() {
+		if (count > 0) flush();
+		if (pending.valid()) pending.get();
+		if (std::fclose(file) != 0) {
+			file = nullptr;
+			throw "Write error in the external sort!";
+		}
+		file = nullptr;
+	}
+
+private:
+	std::FILE* file;
+	std::vector<T> current;
+	std::vector<T> next;
+	size_t count;
+	std::future<void> pending;
+
+	void flush() {
+		// the previous write has to be done before we can reuse its block
+		if (pending.valid()) pending.get();
+		std::swap(current, next);
+		std::FILE* target = file;
+		const T* records = next.data();
+		size_t numRecords = count;
+		pending = std::async(std::launch::async, [target, records, numRecords]() { writeRecords(target, records, numRecords); });
+		count = 0;
+	}
+};
+
+/*
+	Phase 1: cuts the input into runs of recordsPerRun records, sorts each run and writes it to its own temp file
+	We keep four buffers: the run being sorted, the scratch buffer for mergeSort, the next run that is being read in the background
+	and the previous run that is being written in the background, so the sort of one run overlaps both the read of the next one
+	and the write of the previous one
+	Returns the paths of the runs in input order
+*/
+template<typename T, class Compare>
+std::vector<std::string> createSortedRuns(const std::string& inputPath, size_t recordsPerRun, const std::string& tempPrefix, Compare cmp) {
+	using namespace std;
+	vector<string> runs;
+	vector<T> current(recordsPerRun);
+	vector<T> next(recordsPerRun);
+	vector<T> scratch(recordsPerRun);
+	vector<T> writing(recordsPerRun);
+	FILE* input = openRecordFile(inputPath, "rb");
+	future<void> pendingWrite;
+	try {
+		size_t currentCount = readRecords(input, current.data(), recordsPerRun);
+		while (currentCount > 0) {
+			T* target = next.data();
+			future<size_t> nextCount = async(launch::async, [input, target, recordsPerRun]() { return readRecords(input, target, recordsPerRun); });
+
+			mergeSort(current.begin(), current.begin() + currentCount, scratch.begin(), cmp);
+
+			// the previous run has to be on disk before we can reuse its buffer
+			if (pendingWrite.valid()) pendingWrite.get();
+			swap(current, writing);
+			string path = tempPrefix + to_string(runs.size());
+			FILE* output = openRecordFile(path, "wb");
+			runs.push_back(path);
+			const T* records = writing.data();
+			pendingWrite = async(launch::async, [output, records, currentCount]() {
+				try {
+					writeRecords(output, records, currentCount);
+				}
+				catch (...) {
+					fclose(output);
+					throw;
+				}
+				if (fclose(output) != 0) {
+					throw "Write error in the external sort!";
+				}
+			});
+
+			// current now holds the buffer of the write that just finished, so it is free for the read after this one
+			currentCount = nextCount.get();
+			swap(current, next);
+		}
+		if (pendingWrite.valid()) pendingWrite.get();
+	}
+	catch (...) {
+		// a write that is still going uses one of our buffers and one of the files, so it has to finish first
+		if (pendingWrite.valid()) pendingWrite.wait();
+		fclose(input);
+		for (size_t i = 0; i < runs.size(); i++) remove(runs[i].c_str());
+		throw;
+	}
+	fclose(input);
+	return runs;
+}
+
+/*
+	Phase 2 building block: k-way merge of the sorted runs into outputPath
+	A heap holds one entry per run that still has records, keyed by the run's current head (ties go to the earlier run)
+*/
+template<typename T, class Compare>
+void mergeRuns(const std::vector<std::string>& runs, const std::string& outputPath, size_t blockRecords, Compare cmp) {
+	using namespace std;
+	vector<unique_ptr<RunReader<T>>> readers;
+	for (size_t i = 0; i < runs.size(); i++) {
+		readers.push_back(unique_ptr<RunReader<T>>(new RunReader<T>(runs[i], blockRecords)));
+	}
+
+	// priority_queue is a max heap, so "less" here means the run whose head should come out later
+	auto later = [&](size_t a, size_t b) {
+		if (cmp(readers[a]->head(), readers[b]->head())) return false;
+		if (cmp(readers[b]->head(), readers[a]->head())) return true;
+		return a > b;
+	};
+	priority_queue<size_t, vector<size_t>, decltype(later)> heap(later);
+	for (size_t i = 0; i < readers.size(); i++) {
+		if (!readers[i]->empty()) heap.push(i);
+	}
+
+	RunWriter<T> writer(outputPath, blockRecords);
+	while (!heap.empty()) {
+		size_t run = heap.top();
+		heap.pop();
+		writer.push(readers[run]->head());
+		readers[run]->advance();
+		if (!readers[run]->empty()) heap.push(run);
+	}
+	writer.close();
+}
+
+/*
+	Sorts the file of T records at inputPath into outputPath while using roughly memoryBudget bytes of memory
+	T has to be trivially copyable since records are read and written as raw bytes
+	Temp files are named tempPrefix followed by a number (by default next to the output file) and are removed when we are done,
+	also when the sort fails (in which case a partially written output file is removed as well)
+*/
+template<typename T, class Compare>
+void externalMergeSort(const std::string& inputPath, const std::string& outputPath, size_t memoryBudget, Compare cmp, std::string tempPrefix = "") {
+	using namespace std;
+	static_assert(is_trivially_copyable<T>::value, "external merge sort reads and writes records as raw bytes");
+	if (tempPrefix.empty()) tempPrefix = outputPath + ".run";
+
+	// run generation keeps four run sized buffers
+	size_t recordsPerRun = memoryBudget / (4 * sizeof(T));
+	if (recordsPerRun == 0) {
+		throw "Memory budget is too small for the external sort!";
+	}
+	vector<string> runs = createSortedRuns<T>(inputPath, recordsPerRun, tempPrefix, cmp);
+
+	// every open run (and the output) needs two blocks, so the budget decides how many runs we can merge at once
+	size_t blockRecords = EXTERNAL_BLOCK_BYTES / sizeof(T);
+	if (blockRecords == 0) blockRecords = 1;
+	size_t fanIn = memoryBudget / (2 * blockRecords * sizeof(T));
+	if (fanIn < 3) {
+		// small budget: shrink the blocks so that we can still merge two runs (plus the output) at a time
+		fanIn = 3;
+		blockRecords = memoryBudget / (2 * fanIn * sizeof(T));
+		if (blockRecords == 0) blockRecords = 1;
+	}
+	fanIn--;
+
+	// the runs written by the current intermediate pass, they are only in runs once the pass is done
+	vector<string> merged;
+	bool writingOutput = false;
+	try {
+		size_t pass = 0;
+		while (runs.size() > fanIn) {
+			// intermediate pass: merge groups of fanIn runs into longer runs
+			for (size_t start = 0; start < runs.size(); start += fanIn) {
+				vector<string> group(runs.begin() + start, runs.begin() + min(start + fanIn, runs.size()));
+				string path = tempPrefix + "_" + to_string(pass) + "_" + to_string(merged.size());
+				// tracked before the merge, so a merge that fails halfway does not leave its file behind
+				merged.push_back(path);
+				mergeRuns<T>(group, path, blockRecords, cmp);
+				for (size_t i = 0; i < group.size(); i++) remove(group[i].c_str());
+			}
+			runs.swap(merged);
+			merged.clear();
+			pass++;
+		}
+		writingOutput = true;
+		mergeRuns<T>(runs, outputPath, blockRecords, cmp);
+	}
+	catch (...) {
+		// runs of the pass that failed may already be gone, remove just fails quietly for those
+		for (size_t i = 0; i < runs.size(); i++) remove(runs[i].c_str());
+		for (size_t i = 0; i < merged.size(); i++) remove(merged[i].c_str());
+		if (writingOutput) remove(outputPath.c_str());
+		throw;
+	}
+	for (size_t i = 0; i < runs.size(); i++) remove(runs[i].c_str());
+}
+
+// external merge sort in ascending order
+template<typename T>
+void externalMergeSort(const std::string& inputPath, const std::string& outputPath, size_t memoryBudget) {
+	externalMergeSort<T>(inputPath, outputPath, memoryBudget, std::less<T>());
+}
@@ -1,43 +1,55 @@
-
+#pragma once
 #include <vector>
+#include <functional>
+#include <utility>
+#include <algorithm>
 
 /*
 	Standard implementation of insertion sort in O(n^2) time to use as a helper function
 */
 
 /*
-	Implementation of insertion sort in place
+	Implementation of insertion sort in place with a comparator
 	Insertion sort is worst case O(n^2) time and uses the idea that we maintain a subarray that is sorted
-	arr is the input array of integers to sort
+	Each new element is shifted left past every element that is strictly greater, so the sort is stable
+	cmp is a strict weak ordering (like std::less)
 */
-template<class RandomAccessIterator>
-void insertionSort(RandomAccessIterator first, RandomAccessIterator last){
+template<class RandomAccessIterator, class Compare>
+void insertionSort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp){
+	if (first == last) return;
 	for (RandomAccessIterator i = first+1; i != last; i++) {
-		RandomAccessIterator j = i-1;
-		for (RandomAccessIterator j = i - 1; j >= first; j--) {
-			if (*i >= *j) {
-				// this is the right position for i
-				break;
-			}
+		auto key = std::move(*i);
+		RandomAccessIterator j = i;
+		// shifting the larger elements of the sorted subarray one spot to the right until we find the right position for key
+		for (; j != first && cmp(key, *(j - 1)); j--) {
+			*j = std::move(*(j - 1));
 		}
-		int tmp = *(j + 1);
-		*(j + 1) = *i;
-		*i = tmp;
+		*j = std::move(key);
 	}
 }
 
+/*
+	Implementation of insertion sort in place
+	arr is the input range to sort in ascending order
+*/
+template<class RandomAccessIterator>
+void insertionSort(RandomAccessIterator first, RandomAccessIterator last){
+	insertionSort(first, last, std::less<>());
+}
+
+/*
+	Binary insertion sort: [first, start) is already sorted and we insert every element of [start, last) into it
+	We binary search for the position after any equal elements (upper bound), so it is stable and needs only O(nlog(n)) comparisons
+	The moves are still O(n^2), which is fine for the short runs that timsort extends with it
+*/
 template<class RandomAccessIterator, class Compare>
-void insertionSort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp){
-	for (RandomAccessIterator i = first+1; i != last; i++) {
-		RandomAccessIterator j = i-1;
-		for (RandomAccessIterator j = i - 1; j >= first; j--) {
-			if (cmp(*i, *j)) {
-				// this is the right position for i
-				break;
-			}
-		}
-		int tmp = *(j + 1);
-		*(j + 1) = *i;
-		*i = tmp;
+void binaryInsertionSort(RandomAccessIterator first, RandomAccessIterator start, RandomAccessIterator last, Compare cmp){
+	if (start == first && start != last) start++;
+	for (RandomAccessIterator i = start; i != last; i++) {
+		RandomAccessIterator position = std::upper_bound(first, i, *i, cmp);
+		auto key = std::move(*i);
+		std::move_backward(position, i, i + 1);
+		*position = std::move(key);
 	}
-}
\ No newline at end of file
+}
+
@@ -0,0 +1,77 @@
+#pragma once
+#include "QuickSort.cpp"
+#include "InsertionSort.cpp"
+#include "SortingNetwork.cpp"
+#include "../Data Structures/Heap.cpp"
+#include <functional>
+#include <iterator>
+#include <cstddef>
+
+/*
+	Introsort (introspective sort) is the hybrid that most standard libraries ship as their sort
+	It combines three sorts I already have:
+		quicksort with median of three pivots does most of the work (fast in practice)
+		heapsort takes over once the recursion gets deeper than 2*lg(n), so the worst case is O(nlog(n))
+		insertion sort finishes the small ranges, where it beats both of the others
+		(or the sorting networks, for ascending sorts of contiguous ints, floats and doubles, see leafSort)
+*/
+
+// ranges with at most this many elements are finished with leafSort (SORTING_NETWORK_LEAF_SIZE when that uses the networks)
+const std::ptrdiff_t INTROSORT_THRESHOLD = 16;
+
+// floor(lg(n)) for n >= 1
+inline int floorLog2(std::ptrdiff_t n) {
+	int log = 0;
+	while (n > 1) {
+		n >>= 1;
+		log++;
+	}
+	return log;
+}
+
+/*
+	Recursive loop of introsort
+	We only recurse on the smaller of the < and > sides of each partition and loop on the larger one, so the call stack is O(log(n))
+	depthLimit is how many more partitions we are allowed on this path before giving up on quicksort
+*/
+template<class RandomAccessIterator, class Compare>
+void introsortLoop(RandomAccessIterator first, RandomAccessIterator last, int depthLimit, Compare cmp) {
+	const std::ptrdiff_t threshold = leafSortThreshold<RandomAccessIterator, Compare>(INTROSORT_THRESHOLD);
+	while (last - first > threshold) {
+		if (depthLimit == 0) {
+			// quicksort is degenerating on this input, so heapsort the rest of the range
+			Heap::heapsort(first, last, cmp);
+			return;
+		}
+		depthLimit--;
+
+		// three way, so the keys equal to the pivot are done and few distinct keys do not run into the depth limit
+		std::iter_swap(medianOfThree(first, first + (last - first) / 2, last - 1, cmp), last - 1);
+		std::pair<RandomAccessIterator, RandomAccessIterator> equal = threeWayPartitionRange(first, last, cmp);
+		if (equal.first - first < last - equal.second) {
+			introsortLoop(first, equal.first, depthLimit, cmp);
+			first = equal.second;
+		}
+		else {
+			introsortLoop(equal.second, last, depthLimit, cmp);
+			last = equal.first;
+		}
+	}
+	leafSort(first, last, cmp);
+}
+
+/*
+	Introsort on [first, last) with a comparator, worst case O(nlog(n)) and not stable
+	cmp is a strict weak ordering (like std::less)
+*/
+template<class RandomAccessIterator, class Compare>
+void introsort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+	if (last - first < 2) return;
+	introsortLoop(first, last, 2 * floorLog2(last - first), cmp);
+}
+
+// introsort in ascending order
+template<class RandomAccessIterator>
+void introsort(RandomAccessIterator first, RandomAccessIterator last) {
+	introsort(first, last, std::less<>());
+}
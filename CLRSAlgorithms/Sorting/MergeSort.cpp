@@ -1,4 +1,11 @@
+#pragma once
+#include "InsertionSort.cpp"
+#include "ParallelHelpers.cpp"
 #include <vector>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <cstddef>
 
 
 /*
@@ -6,41 +13,17 @@
 	Recurrence relation is T(n) = 2T(n/2) + O(n) so we have O(nlg(n)) by the master theorem
 */
 
-/*
-	Input is an array of integers
-	Output is the sorted array
-	This is a divide and conquer recursive algorithm
-*/
-std::vector<int> mergeSort(std::vector<int> arr) {
-	using namespace std;
-	// if the array is empty or 1, just return it
-	if (arr.size() <= 1) return arr;
-
-	// otherwise, split the array into 2 (if the array is odd, we will have one subarray with one more element than the other subarray)
-	size_t const middle = arr.size() / 2;
-	vector<int>::iterator middleIterator = arr.begin();
-	advance(middleIterator, middle);
-
-	vector<int> leftHalf = vector<int>(arr.begin(), middleIterator);
-	vector<int> rightHalf = vector<int>(middleIterator, arr.end());
-
-	mergeSort(leftHalf);
-	mergeSort(rightHalf);
-
-	return merge(leftHalf, rightHalf);
-}
-
-
 // merge operation to merge 2 sorted arrays
-std::vector<int> merge(std::vector<int> first, std::vector<int> second) {
+// on ties we take from first, so merging keeps the sort stable
+std::vector<int> merge(const std::vector<int>& first, const std::vector<int>& second) {
 	using namespace std;
-	vector<int> result = vector<int>(0, first.size() + second.size());
+	vector<int> result = vector<int>(first.size() + second.size(), 0);
 	int numInserted = 0;
 	int fingerOne = 0;
 	int fingerTwo = 0;
 
 	while (fingerOne < first.size() && fingerTwo < second.size()) {
-		if (first[fingerOne] < second[fingerTwo]) {
+		if (!(second[fingerTwo] < first[fingerOne])) {
 			result[numInserted] = first[fingerOne];
 			fingerOne++;
 		}
@@ -66,4 +49,447 @@ std::vector<int> merge(std::vector<int> first, std::vector<int> second) {
 	}
 
 	return result;
-}
\ No newline at end of file
+}
+
+/*
+	Input is an array of integers
+	Output is the sorted array
+	This is a divide and conquer recursive algorithm
+	Note that this allocates new halves at every level, the iterator version below only allocates once
+*/
+std::vector<int> mergeSort(const std::vector<int>& arr) {
+	using namespace std;
+	// if the array is empty or 1, just return it
+	if (arr.size() <= 1) return arr;
+
+	// otherwise, split the array into 2 (if the array is odd, we will have one subarray with one more element than the other subarray)
+	size_t const middle = arr.size() / 2;
+	vector<int>::const_iterator middleIterator = arr.begin();
+	advance(middleIterator, middle);
+
+	vector<int> leftHalf = mergeSort(vector<int>(arr.begin(), middleIterator));
+	vector<int> rightHalf = mergeSort(vector<int>(middleIterator, arr.end()));
+
+	return merge(leftHalf, rightHalf);
+}
+
+/*
+	Generic version of merge: merges the sorted ranges [first1, last1) and [first2, last2) into out and returns the end of the output
+	Elements are moved, not copied, and on ties we take from the first range so that merging is stable
+	The output must not overlap the inputs
+*/
+template<class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
+OutputIterator mergeRange(InputIterator1 first1, InputIterator1 last1, InputIterator2 first2, InputIterator2 last2, OutputIterator out, Compare cmp) {
+	while (first1 != last1 && first2 != last2) {
+		if (cmp(*first2, *first1)) {
+			*out = std::move(*first2);
+			first2++;
+		}
+		else {
+			*out = std::move(*first1);
+			first1++;
+		}
+		out++;
+	}
+	out = std::move(first1, last1, out);
+	return std::move(first2, last2, out);
+}
+
+// ranges with at most this many elements are sorted with insertion sort instead of being split further
+const std::ptrdiff_t MERGESORT_THRESHOLD = 16;
+
+template<class RandomAccessIterator, class BufferIterator, class Compare>
+void mergeSortInto(RandomAccessIterator first, RandomAccessIterator last, BufferIterator out, Compare cmp);
+
+/*
+	Sorts [first, last) in place using [buffer, buffer + n) as scratch space
+	Instead of copying halves back and forth, we sort each half INTO the buffer and then merge the buffer back into [first, last)
+	so the source and destination just alternate between the two arrays on every level (ping pong)
+*/
+template<class RandomAccessIterator, class BufferIterator, class Compare>
+void mergeSortWithBuffer(RandomAccessIterator first, RandomAccessIterator last, BufferIterator buffer, Compare cmp) {
+	std::ptrdiff_t n = last - first;
+	if (n <= MERGESORT_THRESHOLD) {
+		insertionSort(first, last, cmp);
+		return;
+	}
+	std::ptrdiff_t middle = n / 2;
+	mergeSortInto(first, first + middle, buffer, cmp);
+	mergeSortInto(first + middle, last, buffer + middle, cmp);
+	mergeRange(buffer, buffer + middle, buffer + middle, buffer + n, first, cmp);
+}
+
+/*
+	Sorts [first, last) and leaves the result in [out, out + n), [first, last) is used as the scratch space this time
+*/
+template<class RandomAccessIterator, class BufferIterator, class Compare>
+void mergeSortInto(RandomAccessIterator first, RandomAccessIterator last, BufferIterator out, Compare cmp) {
+	std::ptrdiff_t n = last - first;
+	if (n <= MERGESORT_THRESHOLD) {
+		insertionSort(first, last, cmp);
+		std::move(first, last, out);
+		return;
+	}
+	std::ptrdiff_t middle = n / 2;
+	mergeSortWithBuffer(first, first + middle, out, cmp);
+	mergeSortWithBuffer(first + middle, last, out + middle, cmp);
+	mergeRange(first, first + middle, first + middle, last, out, cmp);
+}
+
+/*
+	Stable merge sort on [first, last) using a caller supplied buffer that can hold at least last - first elements
+	This does not allocate at all, so the caller can reuse one buffer across many sorts
+*/
+template<class RandomAccessIterator, class BufferIterator, class Compare>
+void mergeSort(RandomAccessIterator first, RandomAccessIterator last, BufferIterator buffer, Compare cmp) {
+	mergeSortWithBuffer(first, last, buffer, cmp);
+}
+
+/*
+	Stable merge sort on any random access range with a comparator
+	We allocate one buffer of n elements up front, and that is the only allocation of the whole sort
+	The elements are moved (not copied) into the buffer and sorted from there back into [first, last), so move only types work too
+*/
+template<class RandomAccessIterator, class Compare>
+void mergeSort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+	typedef typename std::iterator_traits<RandomAccessIterator>::value_type T;
+	if (last - first < 2) return;
+	std::vector<T> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+	mergeSortInto(buffer.begin(), buffer.end(), first, cmp);
+}
+
+// stable merge sort in ascending order
+template<class RandomAccessIterator>
+void mergeSort(RandomAccessIterator first, RandomAccessIterator last) {
+	mergeSort(first, last, std::less<>());
+}
+
+/*
+	Co-ranking (merge path) for the stable merge of the sorted ranges a[0..m) and b[0..n)
+	Returns i such that the first k elements of the merge are exactly a[0..i) and b[0..k-i)
+	This is a binary search, so we can find where any output position comes from in O(log(n)) without merging up to it
+*/
+template<class RandomAccessIterator1, class RandomAccessIterator2, class Compare>
+std::ptrdiff_t coRank(std::ptrdiff_t k, RandomAccessIterator1 a, std::ptrdiff_t m, RandomAccessIterator2 b, std::ptrdiff_t n, Compare cmp) {
+	std::ptrdiff_t low = k > n ? k - n : 0;
+	std::ptrdiff_t high = k < m ? k : m;
+	while (low < high) {
+		std::ptrdiff_t i = low + (high - low) / 2;
+		std::ptrdiff_t j = k - i;
+		// i is too small if a[i] comes out of the merge before b[j-1] (on ties a goes first)
+		if (j > 0 && i < m && !cmp(b[j - 1], a[i])) {
+			low = i + 1;
+		}
+		else {
+			high = i;
+		}
+	}
+	return low;
+}
+
+/*
+	One round of the parallel merge sort: merges neighbouring pairs of sorted runs from source into destination
+	runs holds the boundaries of the runs (run r is [runs[r], runs[r+1])), and we return the boundaries after this round
+	Instead of giving each merge to a single thread, every thread takes an equal slice of the whole output
+	and uses coRank to find which parts of the two input runs produce that slice, so even the final merge uses every thread
+*/
+template<class SourceIterator, class DestinationIterator, class Compare>
+std::vector<std::ptrdiff_t> parallelMergeRound(SourceIterator source, DestinationIterator destination, const std::vector<std::ptrdiff_t>& runs, unsigned numThreads, Compare cmp) {
+	using namespace std;
+	ptrdiff_t n = runs.back();
+	size_t numRuns = runs.size() - 1;
+	size_t numPairs = (numRuns + 1) / 2;
+
+	// pair p is the runs [low, middle) and [middle, high), a trailing run without a partner is just moved over
+	auto pairBounds = [&](size_t p, ptrdiff_t& low, ptrdiff_t& middle, ptrdiff_t& high) {
+		low = runs[2 * p];
+		middle = runs[2 * p + 1];
+		high = 2 * p + 2 <= numRuns ? runs[2 * p + 2] : middle;
+	};
+
+	// the split of every pair at every slice boundary is found before any thread starts merging:
+	// coRank reads elements all over both runs, and a neighbouring slice may already have moved them out of source
+	vector<ptrdiff_t> splits((numThreads + 1) * numPairs);
+	for (unsigned id = 0; id <= numThreads; id++) {
+		ptrdiff_t boundary = n * id / numThreads;
+		for (size_t p = 0; p < numPairs; p++) {
+			ptrdiff_t low, middle, high;
+			pairBounds(p, low, middle, high);
+			ptrdiff_t k = min(max(boundary, low), high) - low;
+			splits[id * numPairs + p] = coRank(k, source + low, middle - low, source + middle, high - middle, cmp);
+		}
+	}
+
+	runOnThreads(numThreads, [&](unsigned id) {
+		ptrdiff_t sliceStart = n * id / numThreads;
+		ptrdiff_t sliceEnd = n * (id + 1) / numThreads;
+		for (size_t p = 0; p < numPairs; p++) {
+			ptrdiff_t low, middle, high;
+			pairBounds(p, low, middle, high);
+			if (high <= sliceStart || low >= sliceEnd) continue;
+
+			ptrdiff_t kStart = max(sliceStart, low) - low;
+			ptrdiff_t kEnd = min(sliceEnd, high) - low;
+			ptrdiff_t iStart = splits[id * numPairs + p];
+			ptrdiff_t iEnd = splits[(id + 1) * numPairs + p];
+			mergeRange(source + low + iStart, source + low + iEnd,
+				source + middle + (kStart - iStart), source + middle + (kEnd - iEnd),
+				destination + low + kStart, cmp);
+		}
+	});
+
+	vector<ptrdiff_t> merged;
+	for (size_t r = 0; r < numRuns; r += 2) {
+		merged.push_back(runs[r]);
+	}
+	merged.push_back(n);
+	return merged;
+}
+
+/*
+	Multithreaded stable merge sort
+	Each thread sorts one contiguous leaf with the sequential merge sort, then we merge pairs of runs in rounds
+	with parallelMergeRound, alternating between [first, last) and one n element buffer (the only allocation)
+	numThreads of 0 means we use every hardware thread
+*/
+template<class RandomAccessIterator, class Compare>
+void parallelMergeSort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp, unsigned numThreads = 0) {
+	using namespace std;
+	typedef typename iterator_traits<RandomAccessIterator>::value_type T;
+	ptrdiff_t n = last - first;
+	numThreads = resolveThreadCount(numThreads);
+	// threads are not worth it on small inputs
+	if (numThreads <= 1 || n < (ptrdiff_t)numThreads * 4096) {
+		mergeSort(first, last, cmp);
+		return;
+	}
+
+	// moved out and sorted back, like mergeSort, so move only types work too
+	vector<T> buffer(make_move_iterator(first), make_move_iterator(last));
+	typename vector<T>::iterator bufferFirst = buffer.begin();
+
+	vector<ptrdiff_t> runs;
+	for (unsigned id = 0; id <= numThreads; id++) {
+		runs.push_back(n * id / numThreads);
+	}
+	runOnThreads(numThreads, [&](unsigned id) {
+		mergeSortInto(bufferFirst + runs[id], bufferFirst + runs[id + 1], first + runs[id], cmp);
+	});
+
+	// the sorted runs start out in [first, last), every round flips which array holds them
+	bool inBuffer = false;
+	while (runs.size() > 2) {
+		if (inBuffer) {
+			runs = parallelMergeRound(bufferFirst, first, runs, numThreads, cmp);
+		}
+		else {
+			runs = parallelMergeRound(first, bufferFirst, runs, numThreads, cmp);
+		}
+		inBuffer = !inBuffer;
+	}
+
+	if (inBuffer) {
+		runOnThreads(numThreads, [&](unsigned id) {
+			ptrdiff_t start = n * id / numThreads;
+			ptrdiff_t end = n * (id + 1) / numThreads;
+			move(bufferFirst + start, bufferFirst + end, first + start);
+		});
+	}
+}
+
+/*
+	Timsort mode of merge sort, for input that is already mostly in order (appended logs, time series...)
+	Instead of splitting blindly in half, we look for the runs that are already in the input:
+		ascending runs are kept, strictly descending runs are reversed (strictly, so reversing cannot break stability)
+		runs shorter than minRun are extended with binary insertion sort
+	The runs go on a stack that is merged so that run lengths stay balanced, and merges gallop when one side keeps winning
+	An already sorted input is a single run, so it is sorted in O(n) comparisons
+*/
+
+// once one run wins this many comparisons in a row, the merge switches to galloping
+const std::ptrdiff_t TIMSORT_MIN_GALLOP = 7;
+
+// minimum run length: n / 2^k rounded up so that it lands in [32, 64] and n / minRun is close to a power of two
+inline std::ptrdiff_t timsortMinRun(std::ptrdiff_t n) {
+	std::ptrdiff_t roundUp = 0;
+	while (n >= 64) {
+		roundUp |= n & 1;
+		n >>= 1;
+	}
+	return n + roundUp;
+}
+
+// returns the length of the run that starts at first, and reverses it in place if it is strictly descending
+template<class RandomAccessIterator, class Compare>
+std::ptrdiff_t countRunAndMakeAscending(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+	RandomAccessIterator runEnd = first + 1;
+	if (runEnd == last) return 1;
+	if (cmp(*runEnd, *first)) {
+		runEnd++;
+		while (runEnd != last && cmp(*runEnd, *(runEnd - 1))) runEnd++;
+		std::reverse(first, runEnd);
+	}
+	else {
+		runEnd++;
+		while (runEnd != last && !cmp(*runEnd, *(runEnd - 1))) runEnd++;
+	}
+	return runEnd - first;
+}
+
+/*
+	Galloping (exponential) search in the sorted range [first, first + n)
+	gallopRight returns how many elements are <= key and gallopLeft returns how many elements are < key
+	We probe offsets 0, 2, 6, 14... and then binary search the last gap, so finding a position p costs O(log(p)) instead of O(log(n))
+*/
+template<class RandomAccessIterator, class T, class Compare>
+std::ptrdiff_t gallopRight(const T& key, RandomAccessIterator first, std::ptrdiff_t n, Compare cmp) {
+	std::ptrdiff_t lastOffset = 0;
+	std::ptrdiff_t offset = 1;
+	while (offset < n && !cmp(key, first[offset - 1])) {
+		lastOffset = offset;
+		offset = 2 * offset + 1;
+	}
+	if (offset > n) offset = n;
+	return std::upper_bound(first + lastOffset, first + offset, key, cmp) - first;
+}
+
+template<class RandomAccessIterator, class T, class Compare>
+std::ptrdiff_t gallopLeft(const T& key, RandomAccessIterator first, std::ptrdiff_t n, Compare cmp) {
+	std::ptrdiff_t lastOffset = 0;
+	std::ptrdiff_t offset = 1;
+	while (offset < n && cmp(first[offset - 1], key)) {
+		lastOffset = offset;
+		offset = 2 * offset + 1;
+	}
+	if (offset > n) offset = n;
+	return std::lower_bound(first + lastOffset, first + offset, key, cmp) - first;
+}
+
+/*
+	Merges the neighbouring sorted runs [base, base + lengthA) and [base + lengthA, base + lengthA + lengthB) in place
+	First we trim the elements that are already in place: the prefix of A that is <= B[0] and the suffix of B that is >= the last element of A
+	Then the rest of A is moved to buffer and merged forward into the gap (B is read ahead of the output, so it never gets overwritten)
+*/
+template<class RandomAccessIterator, class T, class Compare>
+void timsortMerge(RandomAccessIterator base, std::ptrdiff_t lengthA, std::ptrdiff_t lengthB, std::vector<T>& buffer, Compare cmp) {
+	using namespace std;
+	RandomAccessIterator a = base;
+	RandomAccessIterator b = base + lengthA;
+
+	ptrdiff_t inPlace = gallopRight(*b, a, lengthA, cmp);
+	a += inPlace;
+	lengthA -= inPlace;
+	if (lengthA == 0) return;
+	lengthB = gallopLeft(*(a + lengthA - 1), b, lengthB, cmp);
+	if (lengthB == 0) return;
+
+	buffer.assign(make_move_iterator(a), make_move_iterator(a + lengthA));
+	typename vector<T>::iterator bufferA = buffer.begin();
+	typename vector<T>::iterator bufferEnd = buffer.end();
+	RandomAccessIterator out = a;
+	RandomAccessIterator bEnd = b + lengthB;
+
+	ptrdiff_t winsA = 0;
+	ptrdiff_t winsB = 0;
+	while (bufferA != bufferEnd && b != bEnd) {
+		if (cmp(*b, *bufferA)) {
+			*out = move(*b);
+			b++;
+			winsB++;
+			winsA = 0;
+		}
+		else {
+			*out = move(*bufferA);
+			bufferA++;
+			winsA++;
+			winsB = 0;
+		}
+		out++;
+
+		if ((winsA >= TIMSORT_MIN_GALLOP || winsB >= TIMSORT_MIN_GALLOP) && bufferA != bufferEnd && b != bEnd) {
+			// one run keeps winning, so gallop to find the whole streak and move it as one block
+			ptrdiff_t countA = gallopRight(*b, bufferA, bufferEnd - bufferA, cmp);
+			out = move(bufferA, bufferA + countA, out);
+			bufferA += countA;
+			if (bufferA != bufferEnd) {
+				ptrdiff_t countB = gallopLeft(*bufferA, b, bEnd - b, cmp);
+				out = move(b, b + countB, out);
+				b += countB;
+			}
+			winsA = 0;
+			winsB = 0;
+		}
+	}
+	// whatever is left of B is already in its final place
+	move(bufferA, bufferEnd, out);
+}
+
+/*
+	Timsort on [first, last), stable and O(nlog(n)) in the worst case, O(n) on sorted or reverse sorted input
+	cmp is a strict weak ordering (like std::less)
+*/
+template<class RandomAccessIterator, class Compare>
+void timSort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+	using namespace std;
+	typedef typename iterator_traits<RandomAccessIterator>::value_type T;
+	ptrdiff_t n = last - first;
+	if (n < 2) return;
+	ptrdiff_t minRun = timsortMinRun(n);
+
+	// the pending runs, run i is [first + runBase[i], first + runBase[i] + runLength[i])
+	vector<ptrdiff_t> runBase;
+	vector<ptrdiff_t> runLength;
+	// scratch space for the merges, it only grows as needed
+	vector<T> buffer;
+	buffer.reserve(n / 2);
+
+	auto mergeAt = [&](size_t i) {
+		timsortMerge(first + runBase[i], runLength[i], runLength[i + 1], buffer, cmp);
+		runLength[i] += runLength[i + 1];
+		runBase.erase(runBase.begin() + i + 1);
+		runLength.erase(runLength.begin() + i + 1);
+	};
+
+	RandomAccessIterator current = first;
+	while (current != last) {
+		ptrdiff_t length = countRunAndMakeAscending(current, last, cmp);
+		if (length < minRun) {
+			ptrdiff_t forced = min(minRun, (ptrdiff_t)(last - current));
+			binaryInsertionSort(current, current + length, current + forced, cmp);
+			length = forced;
+		}
+		runBase.push_back(current - first);
+		runLength.push_back(length);
+		current += length;
+
+		// keeping the run lengths balanced: the top three runs must satisfy X > Y + Z and Y > Z
+		// (we also check the run below them, which is the fix for the invariant bug found in the original timsort)
+		while (runLength.size() > 1) {
+			size_t i = runLength.size() - 2;
+			if ((i > 0 && runLength[i - 1] <= runLength[i] + runLength[i + 1]) || (i > 1 && runLength[i - 2] <= runLength[i - 1] + runLength[i])) {
+				if (runLength[i - 1] < runLength[i + 1]) i--;
+				mergeAt(i);
+			}
+			else if (runLength[i] <= runLength[i + 1]) {
+				mergeAt(i);
+			}
+			else {
+				break;
+			}
+		}
+	}
+
+	// merging whatever is left on the stack
+	while (runLength.size() > 1) {
+		size_t i = runLength.size() - 2;
+		if (i > 0 && runLength[i - 1] < runLength[i + 1]) i--;
+		mergeAt(i);
+	}
+}
+
+// timsort in ascending order
+template<class RandomAccessIterator>
+void timSort(RandomAccessIterator first, RandomAccessIterator last) {
+	timSort(first, last, std::less<>());
+}
+
@@ -1,6 +1,19 @@
+#pragma once
 #include <vector>
 #include <unordered_map>
-#include "LinkedList.cpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include "InsertionSort.cpp"
+#include "SortingNetwork.cpp"
+#include "ParallelHelpers.cpp"
+#include "Introsort.cpp"
 
 
 /*
@@ -11,9 +24,9 @@
 // counting sort runs in O(n+k) time where k is the maximum value in the array
 // The assumption is that all the integers in the input array are values from 0 to k (k>0)
 // Note that counting sort is STABLE (if two elements are equal, then sorting will preserve their order in the input array)
-std::vector<int> countingSort(std::vector<int> arr, int k) {
+std::vector<int> countingSort(const std::vector<int>& arr, int k) {
 	using namespace std;
-	vector<int> store = vector<int>(k,0);
+	vector<int> store = vector<int>(k+1,0);
 	vector<int> result = vector<int>(arr.size(),0);
 	for (int i = 0; i < arr.size(); i++) {
 		store[arr[i]] ++;
@@ -21,7 +34,7 @@ std::vector<int> countingSort(std::vector<int> arr, int k) {
 
 	for (int j = 1; j < store.size(); j++) {
 		// store[j] is now the number of elements less than or equal to j
-		store[j] = store[j - 1] + 1;
+		store[j] += store[j - 1];
 	}
 	
 	for (int i = arr.size()-1; i >=0; i--) {
@@ -32,6 +45,69 @@ std::vector<int> countingSort(std::vector<int> arr, int k) {
 	return result;
 }
 
+/*
+	Key/payload counting sort: sorts keys (values from 0 to k) and moves values[i] along with keys[i]
+	Keys and values are separate arrays (structure of arrays), so the counting pass only reads the keys
+	Stable like countingSort, both arrays are sorted in place
+*/
+template<typename V>
+void countingSortKeyValue(std::vector<int>& keys, std::vector<V>& values, int k) {
+	using namespace std;
+	if (keys.size() != values.size()) {
+		throw "Keys and values must have the same length!";
+	}
+	vector<size_t> store = vector<size_t>(k+1,0);
+	for (size_t i = 0; i < keys.size(); i++) {
+		store[keys[i]] ++;
+	}
+
+	// exclusive prefix sum: store[j] is now the number of keys less than j (where the first j goes)
+	size_t sum = 0;
+	for (size_t j = 0; j < store.size(); j++) {
+		size_t count = store[j];
+		store[j] = sum;
+		sum += count;
+	}
+
+	vector<int> sortedKeys = vector<int>(keys.size());
+	vector<V> sortedValues = vector<V>(values.size());
+	for (size_t i = 0; i < keys.size(); i++) {
+		size_t position = store[keys[i]]++;
+		sortedKeys[position] = keys[i];
+		sortedValues[position] = std::move(values[i]);
+	}
+	keys.swap(sortedKeys);
+	values.swap(sortedValues);
+}
+
+/*
+	Counting sort argsort: returns the permutation that stably sorts keys (values from 0 to k) without moving any keys
+	result[r] is the index of the element with rank r, so rows can be read (or gathered) in sorted order afterwards
+*/
+std::vector<uint32_t> countingArgsort(const std::vector<int>& keys, int k) {
+	using namespace std;
+	if (keys.size() > UINT32_MAX) {
+		throw "Too many keys for 32 bit row indices!";
+	}
+	vector<size_t> store = vector<size_t>(k+1,0);
+	for (size_t i = 0; i < keys.size(); i++) {
+		store[keys[i]] ++;
+	}
+
+	size_t sum = 0;
+	for (size_t j = 0; j < store.size(); j++) {
+		size_t count = store[j];
+		store[j] = sum;
+		sum += count;
+	}
+
+	vector<uint32_t> order = vector<uint32_t>(keys.size());
+	for (size_t i = 0; i < keys.size(); i++) {
+		order[store[keys[i]]++] = (uint32_t)i;
+	}
+	return order;
+}
+
 // helper for radix sort that just sorts arr on a specific digit (in base 10)
 std::vector<int> countingSortRadixHelper(std::vector<int> arr, int k, int digit) {
 	using namespace std;
@@ -46,7 +122,7 @@ std::vector<int> countingSortRadixHelper(std::vector<int> arr, int k, int digit)
 
 	for (int j = 1; j < store.size(); j++) {
 		// store[j] is now the number of elements less than or equal to j
-		store[j] = store[j - 1] + 1;
+		store[j] += store[j - 1];
 	}
 	
 	for (int i = arr.size()-1; i >=0; i--) {
@@ -62,9 +138,9 @@ std::vector<int> countingSortRadixHelper(std::vector<int> arr, int k, int digit)
 // implementation of counting sort using a hash map (gets around the negative value conundrum)
 // we also sort in place here (using an unordered map, we do not have a stable sort!)
 // takes O(k+n) time because we iterate through k elements but we insert at most n 
-void countingSortHashMap(std::vector<int> arr) {
+void countingSortHashMap(std::vector<int>& arr) {
 	using namespace std;
-	unordered_map<int, int> map = new unordered_map<int, int>();
+	unordered_map<int, int> map;
 	// we need to keep track of the smallest and largest element
 	int smallest = INT32_MAX;
 	int largest = INT32_MIN;
@@ -97,18 +173,18 @@ std::vector<int> countingSortRadixBinaryHelper(std::vector<int> arr, int digit)
 	vector<int> store = vector<int>(2,0);
 	vector<int> result = vector<int>(arr.size(),0);
 	for (int i = 0; i < arr.size(); i++) {
-		int bitmask = 2 << digit;
+		int bitmask = 1 << digit;
 		int digitValue = (arr[i] & bitmask) >> digit;
 		store[digitValue] ++;
 	}
 
 	for (int j = 1; j < store.size(); j++) {
 		// store[j] is now the number of elements less than or equal to j
-		store[j] = store[j - 1] + 1;
+		store[j] += store[j - 1];
 	}
 	
 	for (int i = arr.size()-1; i >=0; i--) {
-		int bitmask = 2 << digit;
+		int bitmask = 1 << digit;
 		int digitValue = (arr[i] & bitmask) >> digit;
 		result[store[digitValue]-1] = arr[i];
 		store[digitValue]--;
@@ -126,7 +202,7 @@ std::vector<int> radixSort(std::vector<int> arr, int d) {
 	using namespace std;
 	vector<int> res = arr;
 	for (int i = 0; i < d; i++) {
-		res = countingSortRadixHelper(res,9,d);
+		res = countingSortRadixHelper(res,10,i);
 	}
 	return res;
 }
@@ -137,43 +213,678 @@ std::vector<int> radixSortBinary(std::vector<int> arr, int d) {
 	using namespace std;
 	vector<int> res = arr;
 	for (int i = 0; i < d; i++) {
-		res = countingSortRadixBinaryHelper(res,d);
+		res = countingSortRadixBinaryHelper(res,i);
 	}
 	return res;
 	
 }
 
-// bucket sort splits the input into buckets and then sorts within buckets
-// we use a linked list of buckets in order to accomplish this
-// the input array are values from [0,1), note that we can just divide any array by the largest value + 1 to achieve something similar 
-// we sort in place
-// todo: implement generics
-void bucketSort(std::vector<int> arr) {
-	// initializing a bucket-list	
-	std::vector<LinkedList> buckets = new std::vector<LinkedList>(arr.size(), new LinkedList());
+/*
+	Radix sorts work on the bits of unsigned integers, so every key type is mapped to an unsigned integer of the same width with the same order
+	unsigned integers: nothing to do
+	signed integers: flip the sign bit so that negative numbers come before positive ones
+	floats and doubles: set the sign bit of positive numbers, and flip every bit of negative numbers (larger magnitudes have to come first)
+*/
+inline uint8_t radixKey(uint8_t value) { return value; }
+inline uint16_t radixKey(uint16_t value) { return value; }
+inline uint32_t radixKey(uint32_t value) { return value; }
+inline uint64_t radixKey(uint64_t value) { return value; }
+inline uint8_t radixKey(int8_t value) { return (uint8_t)value ^ 0x80u; }
+inline uint16_t radixKey(int16_t value) { return (uint16_t)((uint16_t)value ^ 0x8000u); }
+inline uint32_t radixKey(int32_t value) { return (uint32_t)value ^ 0x80000000u; }
+inline uint64_t radixKey(int64_t value) { return (uint64_t)value ^ 0x8000000000000000ull; }
 
-	for (int i = 0; i < arr.size(); i++) {
-		buckets[(int)(arr[i] * arr.size())].insert(arr[i], 0);
+inline uint32_t radixKey(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+inline uint64_t radixKey(double value) {
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x8000000000000000ull) ? ~bits : bits | 0x8000000000000000ull;
+}
+
+/*
+	Number of bits in a radix sort digit for a key type
+	8 and 16 bit keys use bytes, 32 and 64 bit keys use 11 bits (3 and 6 passes instead of 4 and 8)
+	2048 counters still fit in L1, and every pass we skip saves a full read and scattered write of the array
+*/
+template<typename Key>
+struct RadixDigits {
+	static const int bits = sizeof(Key) >= 4 ? 11 : 8;
+	static const int buckets = 1 << bits;
+	static const int passes = (sizeof(Key) * 8 + bits - 1) / bits;
+};
+
+/*
+	Counts of every digit for every pass in a single read of the keys
+	counts[pass * buckets + digit] is the number of keys whose digit number pass (from the least significant) is digit
+*/
+template<typename T>
+std::vector<size_t> radixHistograms(const T* keys, size_t n) {
+	typedef decltype(radixKey(T())) Key;
+	typedef RadixDigits<Key> Digits;
+	std::vector<size_t> counts(Digits::passes * Digits::buckets, 0);
+	for (size_t i = 0; i < n; i++) {
+		Key key = radixKey(keys[i]);
+		for (int pass = 0; pass < Digits::passes; pass++) {
+			counts[pass * Digits::buckets + ((key >> (pass * Digits::bits)) & (Digits::buckets - 1))]++;
+		}
+	}
+	return counts;
+}
+
+// exclusive prefix sum over the counts of one pass: count[digit] becomes where the first key with this digit goes
+inline void radixPrefixSums(size_t* count, int buckets) {
+	size_t sum = 0;
+	for (int digit = 0; digit < buckets; digit++) {
+		size_t digitCount = count[digit];
+		count[digit] = sum;
+		sum += digitCount;
+	}
+}
+
+/*
+	LSD radix sort for 8/16/32/64 bit integers (signed or unsigned), floats and doubles
+	All the digit histograms are built in one pass up front, and a pass is skipped completely when every key has the same digit there
+	(common for small values in wide types, or for the exponent bits of doubles in a narrow range)
+	We ping pong between arr and one buffer of n elements instead of copying the array on every pass
+	Runs in O(d*n) time for d digits, and the result is stable
+*/
+template<typename T>
+void radixSortLSD(std::vector<T>& arr) {
+	using namespace std;
+	typedef decltype(radixKey(T())) Key;
+	typedef RadixDigits<Key> Digits;
+	size_t n = arr.size();
+	if (n < 2) return;
+
+	vector<size_t> counts = radixHistograms(arr.data(), n);
+	vector<T> buffer(n);
+	T* source = arr.data();
+	T* destination = buffer.data();
+
+	for (int pass = 0; pass < Digits::passes; pass++) {
+		size_t* count = &counts[pass * Digits::buckets];
+		int shift = pass * Digits::bits;
+		if (count[(radixKey(source[0]) >> shift) & (Digits::buckets - 1)] == n) continue;
+
+		radixPrefixSums(count, Digits::buckets);
+		for (size_t i = 0; i < n; i++) {
+			Key key = radixKey(source[i]);
+			destination[count[(key >> shift) & (Digits::buckets - 1)]++] = source[i];
+		}
+		swap(source, destination);
+	}
+
+	// after an odd number of passes the sorted keys are in the buffer
+	if (source != arr.data()) {
+		copy(buffer.begin(), buffer.end(), arr.begin());
+	}
+}
+
+/*
+	Key/payload LSD radix sort: sorts keys like radixSortLSD and moves values[i] along with keys[i]
+	Keys and payloads are kept in separate arrays (structure of arrays), so the histogram pass only reads keys
+	and wide payloads do not dilute the cache lines of the keys. Stable, both arrays are sorted in place
+*/
+template<typename K, typename V>
+void radixSortKeyValue(std::vector<K>& keys, std::vector<V>& values) {
+	using namespace std;
+	typedef decltype(radixKey(K())) Key;
+	typedef RadixDigits<Key> Digits;
+	if (keys.size() != values.size()) {
+		throw "Keys and values must have the same length!";
+	}
+	size_t n = keys.size();
+	if (n < 2) return;
+
+	vector<size_t> counts = radixHistograms(keys.data(), n);
+	vector<K> keyBuffer(n);
+	vector<V> valueBuffer(n);
+	K* sourceKeys = keys.data();
+	K* destinationKeys = keyBuffer.data();
+	V* sourceValues = values.data();
+	V* destinationValues = valueBuffer.data();
+
+	for (int pass = 0; pass < Digits::passes; pass++) {
+		size_t* count = &counts[pass * Digits::buckets];
+		int shift = pass * Digits::bits;
+		if (count[(radixKey(sourceKeys[0]) >> shift) & (Digits::buckets - 1)] == n) continue;
+
+		radixPrefixSums(count, Digits::buckets);
+		for (size_t i = 0; i < n; i++) {
+			Key key = radixKey(sourceKeys[i]);
+			size_t position = count[(key >> shift) & (Digits::buckets - 1)]++;
+			destinationKeys[position] = sourceKeys[i];
+			destinationValues[position] = std::move(sourceValues[i]);
+		}
+		swap(sourceKeys, destinationKeys);
+		swap(sourceValues, destinationValues);
+	}
+
+	if (sourceKeys != keys.data()) {
+		keys.swap(keyBuffer);
+		values.swap(valueBuffer);
+	}
+}
+
+/*
+	Radix sort argsort: returns the permutation that stably sorts keys, as 32 bit row indices
+	result[r] is the index of the element with rank r, so wide rows never move during the sort
+	We sort a copy of the keys with the row indices as the payload, keys itself is not changed
+*/
+template<typename K>
+std::vector<uint32_t> argsort(const std::vector<K>& keys) {
+	using namespace std;
+	if (keys.size() > UINT32_MAX) {
+		throw "Too many keys for 32 bit row indices!";
+	}
+	vector<K> sortedKeys = keys;
+	vector<uint32_t> order = vector<uint32_t>(keys.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = (uint32_t)i;
+	}
+	radixSortKeyValue(sortedKeys, order);
+	return order;
+}
+
+/*
+	Multithreaded counting sort for keys from a small range (8/16 bit integers, hour of the week, region ids...)
+	The single threaded counting sort is one histogram pass and one scatter pass, both of which split over threads:
+		1. every thread counts the keys of its own chunk into a private histogram (no atomics, no sharing of cache lines)
+		2. one exclusive prefix sum over all the histograms, ordered by key first and thread second,
+		   so thread t's elements with key j go right after the elements with key j of threads 0..t-1
+		3. every thread scatters its chunk (in order) straight into the output, into slots no other thread writes to
+	Since chunks are in input order and each thread scatters its chunk in order, the result is stable
+	The prefix sum is O(k*threads), so the thread count is capped to keep that small next to n
+*/
+
+// below this many elements per thread it is not worth spawning the thread
+const size_t COUNTING_SORT_ELEMENTS_PER_THREAD = 1 << 15;
+// largest key range countingSortParallel sorts with counting, wider ranges go to radix sort
+const size_t COUNTING_SORT_MAX_RANGE = 1 << 20;
+
+// stable parallel counting sort of source into destination, where key(element) is in [0, range)
+template<typename T, class KeyFunction>
+void countingSortParallelScatter(const T* source, T* destination, size_t n, size_t range, KeyFunction key, unsigned numThreads) {
+	using namespace std;
+	numThreads = resolveThreadCount(numThreads);
+	numThreads = (unsigned)max<size_t>(1, min<size_t>(numThreads, n / max(COUNTING_SORT_ELEMENTS_PER_THREAD, range)));
+	size_t chunk = (n + numThreads - 1) / numThreads;
+
+	// 1. private histograms
+	vector<size_t> counts(numThreads * range, 0);
+	runOnThreads(numThreads, [&](unsigned id) {
+		size_t start = min(n, id * chunk);
+		size_t end = min(n, start + chunk);
+		size_t* count = &counts[id * range];
+		for (size_t i = start; i < end; i++) {
+			count[key(source[i])]++;
+		}
+	});
+
+	// 2. exclusive prefix sum, key major and thread minor
+	size_t sum = 0;
+	for (size_t j = 0; j < range; j++) {
+		for (unsigned id = 0; id < numThreads; id++) {
+			size_t count = counts[id * range + j];
+			counts[id * range + j] = sum;
+			sum += count;
+		}
+	}
+
+	// 3. stable scatter
+	runOnThreads(numThreads, [&](unsigned id) {
+		size_t start = min(n, id * chunk);
+		size_t end = min(n, start + chunk);
+		size_t* next = &counts[id * range];
+		for (size_t i = start; i < end; i++) {
+			destination[next[key(source[i])]++] = source[i];
+		}
+	});
+}
+
+/*
+	Sorts any 8/16/32/64 bit integers in place. We find the min and max first (in parallel) and count over [min, max],
+	so 8/16 bit keys always fit and wider keys fit when their values are close together
+	If the range is wider than COUNTING_SORT_MAX_RANGE the histograms would not fit in cache and we use radixSortLSD instead
+*/
+template<typename T>
+void countingSortParallel(std::vector<T>& arr, unsigned numThreads = 0) {
+	using namespace std;
+	typedef decltype(radixKey(T())) Key;
+	size_t n = arr.size();
+	if (n < 2) return;
+	unsigned rangeThreads = (unsigned)max<size_t>(1, min<size_t>(resolveThreadCount(numThreads), n / COUNTING_SORT_ELEMENTS_PER_THREAD));
+	size_t chunk = (n + rangeThreads - 1) / rangeThreads;
+
+	// radixKey maps signed integers to unsigned ones in the same order, so key - lowest is never negative
+	vector<Key> minimums(rangeThreads);
+	vector<Key> maximums(rangeThreads);
+	runOnThreads(rangeThreads, [&](unsigned id) {
+		size_t start = min(n, id * chunk);
+		size_t end = min(n, start + chunk);
+		Key low = radixKey(arr[start]);
+		Key high = low;
+		for (size_t i = start; i < end; i++) {
+			Key key = radixKey(arr[i]);
+			low = min(low, key);
+			high = max(high, key);
+		}
+		minimums[id] = low;
+		maximums[id] = high;
+	});
+	Key lowest = *min_element(minimums.begin(), minimums.end());
+	Key highest = *max_element(maximums.begin(), maximums.end());
+	if ((uint64_t)(highest - lowest) >= COUNTING_SORT_MAX_RANGE) {
+		radixSortLSD(arr);
+		return;
+	}
+
+	vector<T> result = vector<T>(n);
+	countingSortParallelScatter(arr.data(), result.data(), n, (size_t)(highest - lowest) + 1, [lowest](const T& element) {
+		return (size_t)(radixKey(element) - lowest);
+	}, numThreads);
+	arr.swap(result);
+}
+
+/*
+	Sorts records by key(record), which has to be in [0, k] (for example the hour of the week of an event)
+	The records move as a whole, and records with the same key keep their input order
+*/
+template<typename T, class KeyFunction>
+void countingSortParallel(std::vector<T>& records, KeyFunction key, size_t k, unsigned numThreads = 0) {
+	if (records.size() < 2) return;
+	std::vector<T> result = std::vector<T>(records.size());
+	countingSortParallelScatter(records.data(), result.data(), records.size(), k + 1, [&key](const T& record) {
+		return (size_t)key(record);
+	}, numThreads);
+	records.swap(result);
+}
+
+// MSD radix sort digits are always bytes, so a bucket split has 256 buckets
+const int MSD_RADIX_BITS = 8;
+const int MSD_RADIX_BUCKETS = 1 << MSD_RADIX_BITS;
+// buckets with at most this many elements are finished with the small sort kernel (sorting networks for int32/int64/float/double)
+const size_t MSD_RADIX_SMALL_SORT_THRESHOLD = 32;
+
+/*
+	One american flag step: permutes [first, last) in place so that it is grouped by the digit at shift
+	After counting the digits we know where every bucket starts and ends, and we walk cycles:
+	take the element at the next unfilled spot of bucket b, swap it into the next unfilled spot of its own bucket,
+	and keep carrying the displaced element until one belongs to b. Every element moves at most once, and no scratch array is needed
+	bucketStart gets MSD_RADIX_BUCKETS+1 boundaries, bucket d is [first + bucketStart[d], first + bucketStart[d+1])
+*/
+template<typename T>
+void americanFlagPermute(T* first, T* last, int shift, size_t* bucketStart) {
+	size_t n = last - first;
+	size_t count[MSD_RADIX_BUCKETS] = { 0 };
+	for (size_t i = 0; i < n; i++) {
+		count[(radixKey(first[i]) >> shift) & (MSD_RADIX_BUCKETS - 1)]++;
+	}
+
+	size_t head[MSD_RADIX_BUCKETS];
+	bucketStart[0] = 0;
+	for (int digit = 0; digit < MSD_RADIX_BUCKETS; digit++) {
+		head[digit] = bucketStart[digit];
+		bucketStart[digit + 1] = bucketStart[digit] + count[digit];
 	}
 
-	// sorting each bucket
-	for (int i = 0; i < buckets.size(); i++) {
-		buckets[i].insertionSort();
+	for (int bucket = 0; bucket < MSD_RADIX_BUCKETS; bucket++) {
+		while (head[bucket] < bucketStart[bucket + 1]) {
+			T value = first[head[bucket]];
+			int digit = (radixKey(value) >> shift) & (MSD_RADIX_BUCKETS - 1);
+			while (digit != bucket) {
+				std::swap(value, first[head[digit]]);
+				head[digit]++;
+				digit = (radixKey(value) >> shift) & (MSD_RADIX_BUCKETS - 1);
+			}
+			first[head[bucket]] = value;
+			head[bucket]++;
+		}
 	}
+}
+
+/*
+	Sequential american flag sort (in place MSD radix sort) of [first, last), starting at the digit at shift
+*/
+template<typename T>
+void americanFlagSort(T* first, T* last, int shift) {
+	if ((size_t)(last - first) <= MSD_RADIX_SMALL_SORT_THRESHOLD) {
+		smallSort(first, last);
+		return;
+	}
+	size_t bucketStart[MSD_RADIX_BUCKETS + 1];
+	americanFlagPermute(first, last, shift, bucketStart);
+	if (shift == 0) return;
+	for (int digit = 0; digit < MSD_RADIX_BUCKETS; digit++) {
+		if (bucketStart[digit + 1] - bucketStart[digit] > 1) {
+			americanFlagSort(first + bucketStart[digit], first + bucketStart[digit + 1], shift - MSD_RADIX_BITS);
+		}
+	}
+}
+
+/*
+	In place MSD radix sort (american flag sort) for the same key types as radixSortLSD, without any O(n) scratch buffer
+	The buckets of a split are independent, so they go into a shared task list that all the threads work on
+	Buckets larger than parallelCutoff are split again by whichever thread picks them up, smaller ones are sorted sequentially
+	Not stable (the cycle walk moves elements past equal ones), O(w*n) time for w byte digits
+	numThreads of 0 means we use every hardware thread
+*/
+template<typename T>
+void radixSortMSD(std::vector<T>& arr, unsigned numThreads = 0, size_t parallelCutoff = 1 << 16) {
+	using namespace std;
+	typedef decltype(radixKey(T())) Key;
+	const int topShift = (int)(sizeof(Key) * 8) - MSD_RADIX_BITS;
+	size_t n = arr.size();
+	numThreads = resolveThreadCount(numThreads);
+	if (numThreads <= 1 || n <= parallelCutoff) {
+		americanFlagSort(arr.data(), arr.data() + n, topShift);
+		return;
+	}
+
+	struct Task {
+		T* first;
+		T* last;
+		int shift;
+	};
+	vector<Task> tasks;
+	mutex tasksLock;
+	// idle threads sleep on this until there is a task or the sort is done
+	condition_variable tasksOrDone;
+	Task initial = { arr.data(), arr.data() + n, topShift };
+	tasks.push_back(initial);
+	// number of elements that are not known to be in their final position yet, we are done once this hits zero
+	atomic<size_t> remaining(n);
+	auto finished = [&](size_t count) {
+		if ((remaining -= count) == 0) {
+			// taking the lock first means nobody is between checking remaining and going to sleep
+			lock_guard<mutex> guard(tasksLock);
+			tasksOrDone.notify_all();
+		}
+	};
+
+	runOnThreads(numThreads, [&](unsigned) {
+		while (true) {
+			Task task;
+			{
+				unique_lock<mutex> lock(tasksLock);
+				tasksOrDone.wait(lock, [&] { return !tasks.empty() || remaining.load() == 0; });
+				if (tasks.empty()) return;
+				task = tasks.back();
+				tasks.pop_back();
+			}
+
+			size_t size = task.last - task.first;
+			if (size <= parallelCutoff) {
+				americanFlagSort(task.first, task.last, task.shift);
+				finished(size);
+				continue;
+			}
 
-	// returning the buckets concatenated
-	int insertionIndex = 0;
-	for (int i = 0; i < buckets.size(); i++) {
-		LinkedListNode* runner = buckets[i];
-		while (runner != nullptr) {
-			arr[insertionIndex] = runner->item;
-			runner = runner->next;
-			insertionIndex++;
+			size_t bucketStart[MSD_RADIX_BUCKETS + 1];
+			americanFlagPermute(task.first, task.last, task.shift, bucketStart);
+			size_t done = 0;
+			{
+				lock_guard<mutex> guard(tasksLock);
+				for (int digit = 0; digit < MSD_RADIX_BUCKETS; digit++) {
+					size_t bucketSize = bucketStart[digit + 1] - bucketStart[digit];
+					if (bucketSize <= 1 || task.shift == 0) {
+						done += bucketSize;
+					}
+					else {
+						Task bucket = { task.first + bucketStart[digit], task.first + bucketStart[digit + 1], task.shift - MSD_RADIX_BITS };
+						tasks.push_back(bucket);
+					}
+				}
+			}
+			tasksOrDone.notify_all();
+			if (done > 0) finished(done);
 		}
+	});
+}
+
+/*
+	Bucket sort for doubles, multithreaded
+	The old version allocated one linked list per element and insertion sorted the lists, so it spent all of its time in the allocator
+	and chasing pointers. Here every bucket is a contiguous slice of one output buffer:
+		1. every thread works out the bucket of each element in its chunk (kept in an array so we only do it once) and counts its own histogram
+		2. an exclusive prefix sum over the histograms, ordered by bucket and then by thread, gives every thread its own slots in every bucket
+		3. every thread scatters its chunk straight into the buffer, with no locking since the slots do not overlap
+		4. the threads grab buckets off a shared counter and sort them (sorting networks for small buckets, introsort for the rest)
+	Picking the buckets: the classic linear mapping floor(n*(x-min)/(max-min)) is only O(n) when the input is close to uniform,
+	so we first test a sorted sample against the uniform distribution. The number of linear buckets is capped so that every thread's
+	histogram stays in cache, and a bucket that ends up large is bucket sorted again over its own value range, which is uniform as well.
+	If the sample does not fit (skewed or clustered data) we pick
+	splitters out of an oversampled sample instead (like sample sort), which gives every bucket roughly the same number of elements
+	whatever the distribution is. The splitters are laid out as an implicit binary search tree (like a heap, children of j at 2j and 2j+1)
+	so finding the bucket of an element is lg(buckets) steps with no branches to mispredict
+	Buckets that hold copies of a single value (common when the splitters repeat) are detected and skipped
+	NaNs are not supported
+*/
+
+// average number of elements we aim for in one bucket
+const size_t BUCKET_SORT_BUCKET_SIZE = 32;
+// number of sampled elements for the uniformity test
+const size_t BUCKET_SORT_SAMPLE_SIZE = 1024;
+// largest distance between the sample's distribution and the uniform one that we still treat as uniform
+const double BUCKET_SORT_UNIFORM_TOLERANCE = 0.1;
+// for non uniform data we sample this many elements per bucket to choose the splitters
+const size_t BUCKET_SORT_OVERSAMPLING = 16;
+// at most this many buckets with splitters (a power of two), so the splitter tree stays in cache
+const size_t BUCKET_SORT_MAX_SPLITTER_BUCKETS = 1 << 12;
+// at most this many buckets with the linear mapping, so a thread's histogram (and the prefix sum over all of them) stays in cache
+const size_t BUCKET_SORT_MAX_LINEAR_BUCKETS = 1 << 14;
+// how many times a large linear bucket may be bucket sorted again before we just introsort it
+const int BUCKET_SORT_MAX_DEPTH = 2;
+// below this many elements per thread it is not worth spawning the thread
+const size_t BUCKET_SORT_ELEMENTS_PER_THREAD = 1 << 14;
+
+// sorted sample of m evenly spaced elements of arr
+inline std::vector<double> bucketSortSample(const std::vector<double>& arr, size_t m) {
+	std::vector<double> sample(m);
+	for (size_t i = 0; i < m; i++) {
+		sample[i] = arr[(size_t)((double)i * arr.size() / m)];
+	}
+	introsort(sample.begin(), sample.end());
+	return sample;
+}
+
+// fills the implicit search tree rooted at node with the sorted splitters, in order (next is the next splitter to place)
+inline void buildSplitterTree(std::vector<double>& tree, size_t node, const std::vector<double>& splitters, size_t& next) {
+	if (node >= tree.size()) return;
+	buildSplitterTree(tree, 2 * node, splitters, next);
+	tree[node] = splitters[next++];
+	buildSplitterTree(tree, 2 * node + 1, splitters, next);
+}
+
+/*
+	Sequential bucket sort of [first, last) with the linear mapping over [low, high), for the buckets of the linear case
+	Elements a little outside of [low, high) (from rounding the bucket bounds) just land in the first or the last bucket
+	Every bucket is sorted by going one level deeper, until depth runs out or the bucket is small
+	scratch holds last - first doubles for the scatter, and the buckets one level down get the matching slices of it,
+	so the whole recursion never allocates a buffer of its own
+*/
+inline void bucketSortLinearRange(double* first, double* last, double* scratch, double low, double high, int depth) {
+	using namespace std;
+	size_t n = last - first;
+	if (n <= SORTING_NETWORK_MAX_SIZE) {
+		smallSort(first, last);
+		return;
+	}
+	// all copies of one value (also keeps us from splitting a range that cannot be split)
+	if (adjacent_find(first, last, not_equal_to<double>()) == last) return;
+	if (depth == 0 || n <= 4 * BUCKET_SORT_BUCKET_SIZE || !(high > low)) {
+		introsort(first, last);
+		return;
+	}
+
+	size_t numBuckets = min(n / BUCKET_SORT_BUCKET_SIZE, BUCKET_SORT_MAX_LINEAR_BUCKETS);
+	double scale = numBuckets / (high - low);
+	auto bucketOf = [&](double x) {
+		double position = (x - low) * scale;
+		return position <= 0 ? (size_t)0 : min(numBuckets - 1, (size_t)position);
+	};
+	vector<size_t> bucketStart(numBuckets + 1, 0);
+	for (double* it = first; it != last; it++) {
+		bucketStart[bucketOf(*it) + 1]++;
+	}
+	for (size_t bucket = 0; bucket < numBuckets; bucket++) {
+		bucketStart[bucket + 1] += bucketStart[bucket];
+	}
+	vector<size_t> next(bucketStart.begin(), bucketStart.end() - 1);
+	for (double* it = first; it != last; it++) {
+		scratch[next[bucketOf(*it)]++] = *it;
+	}
+	copy(scratch, scratch + n, first);
+	for (size_t bucket = 0; bucket < numBuckets; bucket++) {
+		bucketSortLinearRange(first + bucketStart[bucket], first + bucketStart[bucket + 1], scratch + bucketStart[bucket],
+			low + bucket / scale, low + (bucket + 1) / scale, depth - 1);
 	}
 }
 
+inline void bucketSort(std::vector<double>& arr, unsigned numThreads = 0) {
+	using namespace std;
+	size_t n = arr.size();
+	if (n < 2) return;
+	if (n <= BUCKET_SORT_SAMPLE_SIZE) {
+		introsort(arr.begin(), arr.end());
+		return;
+	}
+	numThreads = resolveThreadCount(numThreads);
+	numThreads = (unsigned)max<size_t>(1, min<size_t>(numThreads, n / BUCKET_SORT_ELEMENTS_PER_THREAD));
+	size_t chunk = (n + numThreads - 1) / numThreads;
 
+	// min and max of every chunk
+	vector<double> minimums(numThreads);
+	vector<double> maximums(numThreads);
+	runOnThreads(numThreads, [&](unsigned id) {
+		size_t start = min(n, id * chunk);
+		size_t end = min(n, start + chunk);
+		double low = arr[start];
+		double high = arr[start];
+		for (size_t i = start; i < end; i++) {
+			low = min(low, arr[i]);
+			high = max(high, arr[i]);
+		}
+		minimums[id] = low;
+		maximums[id] = high;
+	});
+	double low = *min_element(minimums.begin(), minimums.end());
+	double high = *max_element(maximums.begin(), maximums.end());
+	if (low == high) return;
 
+	// does a sample look uniform over [low, high]? (the largest gap between the two cumulative distributions)
+	bool linear = isfinite(high - low);
+	if (linear) {
+		vector<double> sample = bucketSortSample(arr, BUCKET_SORT_SAMPLE_SIZE);
+		for (size_t i = 0; i < sample.size() && linear; i++) {
+			double expected = (i + 0.5) / sample.size();
+			linear = fabs((sample[i] - low) / (high - low) - expected) <= BUCKET_SORT_UNIFORM_TOLERANCE;
+		}
+	}
 
+	size_t numBuckets;
+	double scale = 0;
+	vector<double> tree;
+	if (linear) {
+		numBuckets = max<size_t>(1, min(n / BUCKET_SORT_BUCKET_SIZE, BUCKET_SORT_MAX_LINEAR_BUCKETS));
+		scale = numBuckets / (high - low);
+	}
+	else {
+		numBuckets = 2;
+		while (numBuckets * 2 <= min(n / BUCKET_SORT_BUCKET_SIZE, BUCKET_SORT_MAX_SPLITTER_BUCKETS)) numBuckets *= 2;
+		vector<double> sample = bucketSortSample(arr, min(n, numBuckets * BUCKET_SORT_OVERSAMPLING));
+		vector<double> splitters;
+		for (size_t bucket = 1; bucket < numBuckets; bucket++) {
+			splitters.push_back(sample[bucket * sample.size() / numBuckets]);
+		}
+		// node 0 is unused, the root is node 1
+		tree = vector<double>(numBuckets);
+		size_t next = 0;
+		buildSplitterTree(tree, 1, splitters, next);
+	}
+	int levels = floorLog2((ptrdiff_t)numBuckets);
 
+	// 1. bucket of every element and a histogram per thread
+	vector<uint32_t> bucketOf(n);
+	vector<size_t> counts(numThreads * numBuckets, 0);
+	runOnThreads(numThreads, [&](unsigned id) {
+		size_t start = min(n, id * chunk);
+		size_t end = min(n, start + chunk);
+		size_t* count = &counts[id * numBuckets];
+		for (size_t i = start; i < end; i++) {
+			size_t bucket;
+			if (linear) {
+				// rounding can push the max (or something next to it) one past the last bucket
+				bucket = min(numBuckets - 1, (size_t)((arr[i] - low) * scale));
+			}
+			else {
+				// go right when the element is >= the splitter, so we end up in the same bucket as upper_bound would give
+				size_t node = 1;
+				for (int level = 0; level < levels; level++) {
+					node = 2 * node + (arr[i] >= tree[node]);
+				}
+				bucket = node - numBuckets;
+			}
+			bucketOf[i] = (uint32_t)bucket;
+			count[bucket]++;
+		}
+	});
+
+	// 2. exclusive prefix sum, bucket major and thread minor, so the elements of every bucket stay in their input order
+	vector<size_t> bucketStart(numBuckets + 1);
+	size_t sum = 0;
+	for (size_t bucket = 0; bucket < numBuckets; bucket++) {
+		bucketStart[bucket] = sum;
+		for (unsigned id = 0; id < numThreads; id++) {
+			size_t count = counts[id * numBuckets + bucket];
+			counts[id * numBuckets + bucket] = sum;
+			sum += count;
+		}
+	}
+	bucketStart[numBuckets] = n;
+
+	// 3. parallel scatter into the buffer
+	vector<double> buffer(n);
+	runOnThreads(numThreads, [&](unsigned id) {
+		size_t start = min(n, id * chunk);
+		size_t end = min(n, start + chunk);
+		size_t* next = &counts[id * numBuckets];
+		for (size_t i = start; i < end; i++) {
+			buffer[next[bucketOf[i]]++] = arr[i];
+		}
+	});
+
+	// 4. sort the buckets, threads grab a few buckets at a time off the counter
+	// arr is not needed anymore (it gets swapped with buffer at the end), so the linear buckets use the same slice of it as scratch
+	const size_t bucketsPerGrab = 16;
+	atomic<size_t> nextBucket(0);
+	runOnThreads(numThreads, [&](unsigned) {
+		size_t first;
+		while ((first = nextBucket.fetch_add(bucketsPerGrab)) < numBuckets) {
+			size_t last = min(numBuckets, first + bucketsPerGrab);
+			for (size_t bucket = first; bucket < last; bucket++) {
+				double* begin = buffer.data() + bucketStart[bucket];
+				double* end = buffer.data() + bucketStart[bucket + 1];
+				if (linear) {
+					bucketSortLinearRange(begin, end, arr.data() + bucketStart[bucket], low + bucket / scale, low + (bucket + 1) / scale, BUCKET_SORT_MAX_DEPTH);
+					continue;
+				}
+				if (adjacent_find(begin, end, not_equal_to<double>()) == end) {
+					continue;
+				}
+				if ((size_t)(end - begin) <= SORTING_NETWORK_MAX_SIZE) {
+					smallSort(begin, end);
+				}
+				else {
+					introsort(begin, end);
+				}
+			}
+		}
+	});
+	arr.swap(buffer);
+}
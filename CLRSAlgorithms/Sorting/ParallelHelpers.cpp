@@ -0,0 +1,29 @@
+#pragma once
+#include <thread>
+#include <vector>
+
+/*
+	Small helpers shared by the multithreaded sorts
+*/
+
+// numThreads of 0 means every hardware thread (hardware_concurrency can report 0 when it does not know, so we never go below 1)
+inline unsigned resolveThreadCount(unsigned numThreads) {
+	if (numThreads == 0) numThreads = std::thread::hardware_concurrency();
+	return numThreads == 0 ? 1 : numThreads;
+}
+
+/*
+	Calls work(id) for every id from 0 to numThreads-1, each on its own thread, and waits for all of them
+	The calling thread runs id 0 itself so we only spawn numThreads-1 threads
+*/
+template<class Function>
+void runOnThreads(unsigned numThreads, Function work) {
+	std::vector<std::thread> threads;
+	for (unsigned id = 1; id < numThreads; id++) {
+		threads.push_back(std::thread(work, id));
+	}
+	work(0u);
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+}
@@ -1,5 +1,17 @@
+#pragma once
+#include "SortingNetwork.cpp"
+#include "ParallelHelpers.cpp"
 #include <vector>
 #include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <functional>
 
 /*
 	Implementing the O(nlogn) quicksort algorithm as described in CLRS textbook
@@ -13,7 +25,7 @@
 	firstIndex: index of the start of the subarray to partition on
 	lastIndex: index of the end of the subarray to partition on (INCLUSIVE)
 */
-int partition(std::vector<int> arr, int firstIndex, int lastIndex) {
+int partition(std::vector<int>& arr, int firstIndex, int lastIndex) {
 	int start = firstIndex - 1;
 	int pivot = arr[lastIndex];
 	for (int i = firstIndex; i < lastIndex; i++) {
@@ -34,13 +46,136 @@ int partition(std::vector<int> arr, int firstIndex, int lastIndex) {
 	return start;
 }
 
+/*
+	Three way (dutch national flag) partition using the last index of the subarray as the pivot
+	Partition above sends every element equal to the pivot to one side, so an array with only a few distinct values degrades towards O(n^2)
+	Here we split the subarray into < pivot, == pivot and > pivot, and we return the first and last index of the == pivot block (INCLUSIVE)
+	The whole == pivot block is in its sorted position, so the sorts never have to look at it again
+*/
+std::pair<int, int> threeWayPartition(std::vector<int>& arr, int firstIndex, int lastIndex) {
+	int pivot = arr[lastIndex];
+	// arr[firstIndex..lt-1] < pivot, arr[lt..i-1] == pivot, arr[gt+1..lastIndex] > pivot
+	int lt = firstIndex;
+	int i = firstIndex;
+	int gt = lastIndex;
+	while (i <= gt) {
+		if (arr[i] < pivot) {
+			int temp = arr[lt];
+			arr[lt] = arr[i];
+			arr[i] = temp;
+			lt++;
+			i++;
+		}
+		else if (pivot < arr[i]) {
+			int temp = arr[gt];
+			arr[gt] = arr[i];
+			arr[i] = temp;
+			gt--;
+		}
+		else {
+			i++;
+		}
+	}
+	return std::make_pair(lt, gt);
+}
+
+// number of elements that block partition classifies at a time on each side (offsets have to fit in an unsigned char)
+const int PARTITION_BLOCK_SIZE = 128;
+
+/*
+	Block partition (BlockQuicksort by Edelkamp and Weiss) on an iterator range, the pivot is the last element of [first, last)
+	The comparison in the lomuto loop is a coin flip on random data, so the branch predictor misses about half the time
+	Instead, we scan a block on the left for elements that belong on the right (and a block on the right for elements that belong on the left)
+	and we only record their offsets, where the comparison result is added to a counter instead of being branched on
+	Then we swap the recorded pairs unconditionally, so the only branches left are the loop branches
+	Like partitionRange, we return an iterator to the final position of the pivot
+*/
+template<class RandomAccessIterator, class Compare>
+RandomAccessIterator blockPartitionRange(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+	using namespace std;
+	RandomAccessIterator pivot = last - 1;
+	// [first, left) is < pivot, [right, pivot) is >= pivot and [left, right) is not classified yet
+	RandomAccessIterator left = first;
+	RandomAccessIterator right = pivot;
+
+	unsigned char offsetsLeft[PARTITION_BLOCK_SIZE];
+	unsigned char offsetsRight[PARTITION_BLOCK_SIZE];
+	int startLeft = 0;
+	int numLeft = 0;
+	int startRight = 0;
+	int numRight = 0;
+
+	// the left block is [left, left+BLOCK) and the right block is [right-BLOCK, right), so they cannot overlap in this loop
+	while (right - left > 2 * PARTITION_BLOCK_SIZE) {
+		if (numLeft == 0) {
+			startLeft = 0;
+			for (int i = 0; i < PARTITION_BLOCK_SIZE; i++) {
+				offsetsLeft[numLeft] = (unsigned char)i;
+				numLeft += !cmp(left[i], *pivot);
+			}
+		}
+		if (numRight == 0) {
+			startRight = 0;
+			for (int i = 0; i < PARTITION_BLOCK_SIZE; i++) {
+				offsetsRight[numRight] = (unsigned char)i;
+				numRight += cmp(*(right - 1 - i), *pivot);
+			}
+		}
+
+		int numSwaps = min(numLeft, numRight);
+		for (int i = 0; i < numSwaps; i++) {
+			iter_swap(left + offsetsLeft[startLeft + i], right - 1 - offsetsRight[startRight + i]);
+		}
+		numLeft -= numSwaps;
+		numRight -= numSwaps;
+		startLeft += numSwaps;
+		startRight += numSwaps;
+
+		// a block is done once all of its misplaced elements have been swapped away
+		if (numLeft == 0) left += PARTITION_BLOCK_SIZE;
+		if (numRight == 0) right -= PARTITION_BLOCK_SIZE;
+	}
+
+	// at most a couple of blocks are left unclassified (including a block that still has recorded offsets)
+	// we finish them with a branch free lomuto loop: always swap, but only advance store when the element was smaller
+	RandomAccessIterator store = left;
+	for (RandomAccessIterator i = left; i != right; i++) {
+		bool smaller = cmp(*i, *pivot);
+		iter_swap(store, i);
+		store += smaller;
+	}
+	iter_swap(store, pivot);
+	return store;
+}
+
+/*
+	Drop in replacement for partition above that uses block partitioning
+	Same arguments and same result (lastIndex is the pivot and INCLUSIVE), so it can be handed to quickselect as well
+*/
+int blockPartition(std::vector<int>& arr, int firstIndex, int lastIndex) {
+	return blockPartitionRange(arr.begin() + firstIndex, arr.begin() + lastIndex + 1, std::less<int>()) - arr.begin();
+}
+
+/*
+	Which partition scheme the quicksort entry points use
+	LOMUTO is the partition function above (one pivot per call)
+	THREE_WAY excludes the whole run of keys equal to the pivot from further recursion, use it for duplicate heavy input
+	BLOCK is the branch free block partition, which is the fastest on random data
+*/
+enum PartitionScheme {
+	LOMUTO,
+	THREE_WAY,
+	BLOCK
+};
+
 /*
 	Recursive implementation of quicksort
 	If we set usingRandomized to true, we are choosing the pivot randomly (make sure to properly set a seed for randomization!)
 	If usingRandomized is false, we are using the naive partitioning scheme (last element is the pivot)
 	With randomized pivot selection, expected runtime is O(nlog(n))
+	scheme picks the partition function (see PartitionScheme)
 */
-void quicksortRecursive(std::vector<int> arr, int start, int end, bool usingRandomized) {
+void quicksortRecursive(std::vector<int>& arr, int start, int end, bool usingRandomized, PartitionScheme scheme = LOMUTO) {
 	if (start < end) {
 		if (usingRandomized) {
 			int randomIndex = (rand() % (end - start)) + start;
@@ -48,9 +183,15 @@ void quicksortRecursive(std::vector<int> arr, int start, int end, bool usingRand
 			arr[randomIndex] = arr[end];
 			arr[end] = temp;
 		}
-		int sortedPosition = partition(arr, start, end);
-		quicksortRecursive(arr, start, sortedPosition - 1, usingRandomized);
-		quicksortRecursive(arr, sortedPosition + 1, end, usingRandomized);
+		if (scheme == THREE_WAY) {
+			std::pair<int, int> equalRange = threeWayPartition(arr, start, end);
+			quicksortRecursive(arr, start, equalRange.first - 1, usingRandomized, scheme);
+			quicksortRecursive(arr, equalRange.second + 1, end, usingRandomized, scheme);
+			return;
+		}
+		int sortedPosition = scheme == BLOCK ? blockPartition(arr, start, end) : partition(arr, start, end);
+		quicksortRecursive(arr, start, sortedPosition - 1, usingRandomized, scheme);
+		quicksortRecursive(arr, sortedPosition + 1, end, usingRandomized, scheme);
 	}
 }
 
@@ -59,17 +200,20 @@ void quicksortRecursive(std::vector<int> arr, int start, int end, bool usingRand
 	If we set usingRandomized to true, we are choosing the pivot randomly (make sure to properly set a seed for randomization!)
 	If usingRandomized is false, we are using the naive partitioning scheme (last element is the pivot)
 	With randomized pivot selection, expected runtime is O(nlog(n))
+	scheme picks the partition function (see PartitionScheme)
 */
-void quicksort(std::vector<int> arr, int start, int end, bool usingRandomized) {
+void quicksort(std::vector<int>& arr, int start, int end, bool usingRandomized, PartitionScheme scheme = LOMUTO) {
 	using namespace std;
 	// for now we will use a preallocated array as a stack, which should be faster than linked list due to locality
-	// we have maximum N-1 calls to partition since if we are unlucky, our partition may just reveal the largest element in the subarray each time
-	vector<pair<int,int>> stack = vector<pair<int, int>>(end-start);
+	// we have maximum N calls to partition since if we are unlucky, our partition may just reveal the largest element in the subarray each time
+	// every call pops one range and pushes two, so the stack never holds more than N+1 ranges
+	if (start >= end) return;
+	vector<pair<int,int>> stack = vector<pair<int, int>>(end-start+2);
 	int stackSize = 0;
 	stack[stackSize] = make_pair(start, end);
 	stackSize++;
 
-	while (stack.size()!=0) {
+	while (stackSize!=0) {
 		pair<int, int> indices = stack[stackSize-1];
 		int currStart = indices.first;
 		int currEnd = indices.second;
@@ -83,11 +227,26 @@ void quicksort(std::vector<int> arr, int start, int end, bool usingRandomized) {
 				arr[randomIndex] = arr[currEnd];
 				arr[currEnd] = temp;
 			}
-			int pivot = partition(arr, currStart, currEnd);
-			stack[stackSize + 1] = make_pair(pivot + 1, currEnd);
+			// [lower, upper] is the block that is now in its sorted position
+			int lower;
+			int upper;
+			if (scheme == THREE_WAY) {
+				pair<int, int> equalRange = threeWayPartition(arr, currStart, currEnd);
+				lower = equalRange.first;
+				upper = equalRange.second;
+			}
+			else if (scheme == BLOCK) {
+				lower = blockPartition(arr, currStart, currEnd);
+				upper = lower;
+			}
+			else {
+				lower = partition(arr, currStart, currEnd);
+				upper = lower;
+			}
+			stack[stackSize] = make_pair(upper + 1, currEnd);
 			stackSize++;
 
-			stack[stackSize + 1] = make_pair(currStart, pivot - 1);
+			stack[stackSize] = make_pair(currStart, lower - 1);
 			stackSize++;
 			// we will "recurse" on the left side of the array first
 		}
@@ -95,5 +254,215 @@ void quicksort(std::vector<int> arr, int start, int end, bool usingRandomized) {
 	}
 }
 
+/*
+	Iterator version of partition so that the sorts below work on any element type and ordering
+	The pivot is the last element of [first, last) and we return an iterator to its final position
+	cmp is a strict weak ordering (like std::less), the range must not be empty
+*/
+template<class RandomAccessIterator, class Compare>
+RandomAccessIterator partitionRange(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+	RandomAccessIterator pivot = last - 1;
+	RandomAccessIterator store = first;
+	for (RandomAccessIterator i = first; i != pivot; i++) {
+		if (cmp(*i, *pivot)) {
+			std::iter_swap(store, i);
+			store++;
+		}
+	}
+	std::iter_swap(store, pivot);
+	return store;
+}
+
+/*
+	Iterator version of threeWayPartition, the pivot is the last element of [first, last) and the range must not be empty
+	Returns the block [equal.first, equal.second) of elements equivalent to the pivot, which is in its sorted position
+	Uses the Bentley-McIlroy scheme instead of the one in threeWayPartition: we scan from both ends like Hoare and park the keys
+	equal to the pivot at the two ends, then swap them into the middle at the end. So keys that are already on the right side
+	are never moved (sorted input costs no swaps at all), and many equal elements can never make it go quadratic
+*/
+template<class RandomAccessIterator, class Compare>
+std::pair<RandomAccessIterator, RandomAccessIterator> threeWayPartitionRange(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+	typedef typename std::iterator_traits<RandomAccessIterator>::difference_type Index;
+	Index hi = last - first - 1;
+	if (hi == 0) return std::make_pair(first, last);
+	// the pivot sits at first[0] until the very end, so we compare against it in place
+	std::iter_swap(first, last - 1);
+	const RandomAccessIterator pivot = first;
+	// [0, p] and [q, hi] == pivot, (p, i) < pivot, (j, q) > pivot
+	Index i = 0;
+	Index j = hi + 1;
+	Index p = 0;
+	Index q = hi + 1;
+	while (true) {
+		while (cmp(first[++i], *pivot)) {
+			if (i == hi) break;
+		}
+		while (cmp(*pivot, first[--j])) {
+			if (j == 0) break;
+		}
+		if (i == j && !cmp(first[i], *pivot) && !cmp(*pivot, first[i])) {
+			std::iter_swap(first + ++p, first + i);
+		}
+		if (i >= j) break;
+		std::iter_swap(first + i, first + j);
+		// after the swap first[i] <= pivot and first[j] >= pivot, so one comparison tells if they are equal to it
+		if (!cmp(first[i], *pivot)) std::iter_swap(first + ++p, first + i);
+		if (!cmp(*pivot, first[j])) std::iter_swap(first + --q, first + j);
+	}
+
+	// moving the equal keys from both ends next to each other
+	i = j + 1;
+	for (Index k = 0; k <= p; k++) std::iter_swap(first + k, first + j--);
+	for (Index k = hi; k >= q; k--) std::iter_swap(first + k, first + i++);
+	return std::make_pair(first + (j + 1), first + i);
+}
 
+/*
+	Returns the iterator holding the median of *a, *b and *c with respect to cmp (at most 3 comparisons)
+	Pivoting on the median of the first, middle and last elements keeps sorted and reverse sorted input at O(nlog(n))
+*/
+template<class RandomAccessIterator, class Compare>
+RandomAccessIterator medianOfThree(RandomAccessIterator a, RandomAccessIterator b, RandomAccessIterator c, Compare cmp) {
+	if (cmp(*a, *b)) {
+		if (cmp(*b, *c)) return b;
+		return cmp(*a, *c) ? c : a;
+	}
+	if (cmp(*a, *c)) return a;
+	return cmp(*b, *c) ? c : b;
+}
+
+// ranges with at most this many elements are finished with leafSort (SORTING_NETWORK_LEAF_SIZE when that uses the networks)
+const std::ptrdiff_t QUICKSORT_THRESHOLD = 16;
+
+/*
+	Non-Recursive quicksort on an iterator range with a comparator
+	We pivot on the median of three (moved to the back) so that already sorted input does not go quadratic
+	and we partition three ways, so keys equal to the pivot are done right away and lots of duplicates do not go quadratic either
+	The larger half is pushed first so that we always pop the smaller half, which keeps the stack O(log(n)) deep
+*/
+template<class RandomAccessIterator, class Compare>
+void quicksort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+	using namespace std;
+	typedef pair<RandomAccessIterator, RandomAccessIterator> Range;
+	const ptrdiff_t threshold = leafSortThreshold<RandomAccessIterator, Compare>(QUICKSORT_THRESHOLD);
+	vector<Range> stack;
+	stack.push_back(Range(first, last));
+
+	while (!stack.empty()) {
+		Range range = stack.back();
+		stack.pop_back();
+		if (range.second - range.first <= threshold) {
+			leafSort(range.first, range.second, cmp);
+			continue;
+		}
 
+		iter_swap(medianOfThree(range.first, range.first + (range.second - range.first) / 2, range.second - 1, cmp), range.second - 1);
+		Range equal = threeWayPartitionRange(range.first, range.second, cmp);
+		Range left = Range(range.first, equal.first);
+		Range right = Range(equal.second, range.second);
+		if (left.second - left.first < right.second - right.first) {
+			stack.push_back(right);
+			stack.push_back(left);
+		}
+		else {
+			stack.push_back(left);
+			stack.push_back(right);
+		}
+	}
+}
+
+/*
+	Parallel quicksort with work stealing
+	The explicit stack of the quicksort above is really just a queue of independent subranges, so we can hand those out to threads
+	Every worker owns a deque of subranges: the owner pushes and pops at the back, while idle workers steal from the front
+	The front of a deque always holds the oldest (so largest) partitions, which means a single steal hands over a lot of work
+	Once a subrange has at most serialCutoff elements, the worker just sorts it with the serial quicksort
+	A worker that finds every deque empty sleeps on a condition variable until a range is pushed or the sort is done
+	numThreads of 0 means we use every hardware thread
+*/
+template<class RandomAccessIterator, class Compare>
+void parallelQuicksort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp, unsigned numThreads = 0, std::ptrdiff_t serialCutoff = 1 << 14) {
+	using namespace std;
+	typedef pair<RandomAccessIterator, RandomAccessIterator> Range;
+
+	ptrdiff_t n = last - first;
+	numThreads = resolveThreadCount(numThreads);
+	if (serialCutoff < 1) serialCutoff = 1;
+	if (numThreads <= 1 || n <= serialCutoff) {
+		quicksort(first, last, cmp);
+		return;
+	}
+
+	vector<deque<Range>> deques = vector<deque<Range>>(numThreads);
+	vector<mutex> locks(numThreads);
+	// number of elements that are not in their final position yet, once this hits zero every worker can stop
+	atomic<ptrdiff_t> remaining(n);
+	// number of ranges sitting in the deques, idle workers sleep on workOrDone until this is positive or remaining hits zero
+	atomic<ptrdiff_t> queued(1);
+	mutex idleLock;
+	condition_variable workOrDone;
+	deques[0].push_back(Range(first, last));
+
+	// taking idleLock before notifying means a worker cannot miss the wake up between checking and starting to wait
+	auto wakeIdle = [&](bool everyone) {
+		{
+			lock_guard<mutex> guard(idleLock);
+		}
+		if (everyone) workOrDone.notify_all();
+		else workOrDone.notify_one();
+	};
+	auto finished = [&](ptrdiff_t count) {
+		if ((remaining -= count) == 0) wakeIdle(true);
+	};
+
+	runOnThreads(numThreads, [&](unsigned id) {
+		Range range;
+		while (remaining.load() > 0) {
+			bool found = false;
+			{
+				lock_guard<mutex> guard(locks[id]);
+				if (!deques[id].empty()) {
+					range = deques[id].back();
+					deques[id].pop_back();
+					found = true;
+				}
+			}
+			// our own deque is empty, so try to steal from everyone else
+			for (unsigned k = 1; !found && k < numThreads; k++) {
+				unsigned victim = (id + k) % numThreads;
+				lock_guard<mutex> guard(locks[victim]);
+				if (!deques[victim].empty()) {
+					range = deques[victim].front();
+					deques[victim].pop_front();
+					found = true;
+				}
+			}
+			if (!found) {
+				unique_lock<mutex> lock(idleLock);
+				workOrDone.wait(lock, [&] { return queued.load() > 0 || remaining.load() == 0; });
+				continue;
+			}
+			queued--;
+
+			// keep splitting, we hand the larger half to our deque (where it can be stolen) and continue on the smaller half
+			while (range.second - range.first > serialCutoff) {
+				iter_swap(medianOfThree(range.first, range.first + (range.second - range.first) / 2, range.second - 1, cmp), range.second - 1);
+				Range equal = threeWayPartitionRange(range.first, range.second, cmp);
+				// the keys equal to the pivot are all in their final position
+				finished(equal.second - equal.first);
+				Range left = Range(range.first, equal.first);
+				Range right = Range(equal.second, range.second);
+				if (left.second - left.first < right.second - right.first) swap(left, right);
+				{
+					lock_guard<mutex> guard(locks[id]);
+					deques[id].push_back(left);
+				}
+				queued++;
+				wakeIdle(false);
+				range = right;
+			}
+			quicksort(range.first, range.second, cmp);
+			finished(range.second - range.first);
+		}
+	});
+}
@@ -0,0 +1,470 @@
+#pragma once
+#include "InsertionSort.cpp"
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SORTING_NETWORK_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+/*
+	Vectorized sorting networks to use as the small array base case of the divide and conquer sorts
+	A sorting network is a fixed sequence of compare exchanges, so there are no data dependent branches at all
+	and every compare exchange of a stage can run in one SIMD min/max instruction pair
+	I use the bitonic network: it needs (lg(n)^2 + lg(n))/2 stages of n/2 compare exchanges, which is not optimal for size,
+	but every stage pairs element i with element i^j, which maps directly onto vector lanes
+	Blocks are padded up to 8, 16, 32 or 64 elements with the largest value of the type, so the padding sorts to the end
+	The instruction set (AVX2, SSE4.2 or plain scalar code) is picked at runtime from what the cpu supports
+*/
+
+// largest block the networks sort, anything bigger has to be split by the caller
+const size_t SORTING_NETWORK_MAX_SIZE = 64;
+// below this many elements insertion sort is faster than a padded block
+const size_t SORTING_NETWORK_MIN_SIZE = 8;
+
+enum SimdLevel {
+	SIMD_SCALAR,
+	SIMD_SSE4,
+	SIMD_AVX2
+};
+
+// asks the cpu (and the os, for the AVX register state) which instruction set we can use
+inline SimdLevel detectSimdLevel() {
+#if defined(SORTING_NETWORK_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	bool sse42 = (info[2] & (1 << 20)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	bool avx2 = false;
+	if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+	if (avx2) return SIMD_AVX2;
+	if (sse42) return SIMD_SSE4;
+	return SIMD_SCALAR;
+#elif defined(SORTING_NETWORK_X86) && defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+	if (__builtin_cpu_supports("sse4.2")) return SIMD_SSE4;
+	return SIMD_SCALAR;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+// detected once and then cached
+inline SimdLevel simdLevel() {
+	static const SimdLevel level = detectSimdLevel();
+	return level;
+}
+
+/*
+	Scalar bitonic network on a block of n elements (n a power of two), this is the fallback for cpus without SSE4.2
+	k is the size of the bitonic sequences being merged and j is the distance of the compare exchanges in this stage
+	Element i is ascending if bit k of i is clear, the ternaries compile to conditional moves
+*/
+template<typename T>
+void bitonicNetworkScalar(T* data, size_t n) {
+	for (size_t k = 2; k <= n; k <<= 1) {
+		for (size_t j = k >> 1; j > 0; j >>= 1) {
+			for (size_t i = 0; i < n; i++) {
+				size_t partner = i ^ j;
+				if (partner < i) continue;
+				T a = data[i];
+				T b = data[partner];
+				T low = b < a ? b : a;
+				T high = b < a ? a : b;
+				bool ascending = (i & k) == 0;
+				data[i] = ascending ? low : high;
+				data[partner] = ascending ? high : low;
+			}
+		}
+	}
+}
+
+#if defined(SORTING_NETWORK_X86)
+
+/*
+	Each instruction set gets one traits struct per element type with the same interface:
+		lanes: number of elements in a vector
+		load/store: unaligned vector load and store
+		min/max: lane wise minimum and maximum
+		swapLanes(v, j): the vector with lane l holding lane l^j of v (j < lanes)
+		highLanes(i, j, k): mask of the lanes of the vector starting at element i that keep the maximum in the stage (j, k)
+			a lane keeps the maximum if it is the upper element of its pair (bit j of the lane is set),
+			flipped when its bitonic sequence is descending (bit k of the element index is set)
+		blend(low, high, mask): high in the lanes of mask and low elsewhere
+	The structs and the network for an instruction set are compiled for that instruction set only,
+	so the rest of the program does not need to be built with -mavx2 (or /arch:AVX2)
+*/
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse4.2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse4.2")
+#endif
+
+struct Sse4Int32 {
+	typedef int32_t Scalar;
+	typedef __m128i Vec;
+	static const size_t lanes = 4;
+	static inline Vec load(const Scalar* p) { return _mm_loadu_si128((const __m128i*)p); }
+	static inline void store(Scalar* p, Vec v) { _mm_storeu_si128((__m128i*)p, v); }
+	static inline Vec min(Vec a, Vec b) { return _mm_min_epi32(a, b); }
+	static inline Vec max(Vec a, Vec b) { return _mm_max_epi32(a, b); }
+	static inline Vec swapLanes(Vec v, size_t j) {
+		return j == 1 ? _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)) : _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+	}
+	static inline __m128i highLanes(size_t i, size_t j, size_t k) {
+		__m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+		__m128i upper = _mm_cmpeq_epi32(_mm_and_si128(lane, _mm_set1_epi32((int)j)), _mm_set1_epi32((int)j));
+		__m128i descending = k >= lanes ? _mm_set1_epi32(-(int)((i & k) != 0))
+			: _mm_cmpeq_epi32(_mm_and_si128(lane, _mm_set1_epi32((int)k)), _mm_set1_epi32((int)k));
+		return _mm_xor_si128(upper, descending);
+	}
+	static inline Vec blend(Vec low, Vec high, __m128i mask) { return _mm_blendv_epi8(low, high, mask); }
+};
+
+struct Sse4Int64 {
+	typedef int64_t Scalar;
+	typedef __m128i Vec;
+	static const size_t lanes = 2;
+	static inline Vec load(const Scalar* p) { return _mm_loadu_si128((const __m128i*)p); }
+	static inline void store(Scalar* p, Vec v) { _mm_storeu_si128((__m128i*)p, v); }
+	// there is no 64 bit min/max before AVX-512, so we compare (SSE4.2) and blend
+	static inline Vec min(Vec a, Vec b) { return _mm_blendv_epi8(a, b, _mm_cmpgt_epi64(a, b)); }
+	static inline Vec max(Vec a, Vec b) { return _mm_blendv_epi8(b, a, _mm_cmpgt_epi64(a, b)); }
+	static inline Vec swapLanes(Vec v, size_t) { return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)); }
+	static inline __m128i highLanes(size_t i, size_t j, size_t k) {
+		__m128i lane = _mm_set_epi64x(1, 0);
+		__m128i upper = _mm_cmpeq_epi64(_mm_and_si128(lane, _mm_set1_epi64x((long long)j)), _mm_set1_epi64x((long long)j));
+		__m128i descending = k >= lanes ? _mm_set1_epi64x(-(long long)((i & k) != 0))
+			: _mm_cmpeq_epi64(_mm_and_si128(lane, _mm_set1_epi64x((long long)k)), _mm_set1_epi64x((long long)k));
+		return _mm_xor_si128(upper, descending);
+	}
+	static inline Vec blend(Vec low, Vec high, __m128i mask) { return _mm_blendv_epi8(low, high, mask); }
+};
+
+struct Sse4Float {
+	typedef float Scalar;
+	typedef __m128 Vec;
+	static const size_t lanes = 4;
+	static inline Vec load(const Scalar* p) { return _mm_loadu_ps(p); }
+	static inline void store(Scalar* p, Vec v) { _mm_storeu_ps(p, v); }
+	static inline Vec min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+	static inline Vec max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+	static inline Vec swapLanes(Vec v, size_t j) {
+		return j == 1 ? _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)) : _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2));
+	}
+	static inline __m128i highLanes(size_t i, size_t j, size_t k) { return Sse4Int32::highLanes(i, j, k); }
+	static inline Vec blend(Vec low, Vec high, __m128i mask) { return _mm_blendv_ps(low, high, _mm_castsi128_ps(mask)); }
+};
+
+struct Sse4Double {
+	typedef double Scalar;
+	typedef __m128d Vec;
+	static const size_t lanes = 2;
+	static inline Vec load(const Scalar* p) { return _mm_loadu_pd(p); }
+	static inline void store(Scalar* p, Vec v) { _mm_storeu_pd(p, v); }
+	static inline Vec min(Vec a, Vec b) { return _mm_min_pd(a, b); }
+	static inline Vec max(Vec a, Vec b) { return _mm_max_pd(a, b); }
+	static inline Vec swapLanes(Vec v, size_t) { return _mm_shuffle_pd(v, v, 1); }
+	static inline __m128i highLanes(size_t i, size_t j, size_t k) { return Sse4Int64::highLanes(i, j, k); }
+	static inline Vec blend(Vec low, Vec high, __m128i mask) { return _mm_blendv_pd(low, high, _mm_castsi128_pd(mask)); }
+};
+
+/*
+	Bitonic network on a block of n elements (n a power of two, at least V::lanes) with SSE4.2
+	Stages with j >= lanes compare whole vectors, and all lanes of a vector share a direction there, so it is just min/max and two stores
+	Stages with j < lanes compare lanes inside one vector, so we swap lanes, take min/max and blend the right one into each lane
+*/
+template<class V>
+void bitonicNetworkSse4(typename V::Scalar* data, size_t n) {
+	for (size_t k = 2; k <= n; k <<= 1) {
+		for (size_t j = k >> 1; j > 0; j >>= 1) {
+			for (size_t i = 0; i < n; i += V::lanes) {
+				if (j >= V::lanes) {
+					if (i & j) continue;
+					typename V::Vec a = V::load(data + i);
+					typename V::Vec b = V::load(data + i + j);
+					bool ascending = (i & k) == 0;
+					// min and max of floats return their second argument on ties, so the second one takes (b, a) to keep both
+					// of two equal but different values (-0.0 and 0.0) instead of writing b twice
+					V::store(data + i, ascending ? V::min(a, b) : V::max(a, b));
+					V::store(data + i + j, ascending ? V::max(b, a) : V::min(b, a));
+				}
+				else {
+					typename V::Vec v = V::load(data + i);
+					typename V::Vec partner = V::swapLanes(v, j);
+					V::store(data + i, V::blend(V::min(v, partner), V::max(v, partner), V::highLanes(i, j, k)));
+				}
+			}
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+struct Avx2Int32 {
+	typedef int32_t Scalar;
+	typedef __m256i Vec;
+	static const size_t lanes = 8;
+	static inline Vec load(const Scalar* p) { return _mm256_loadu_si256((const __m256i*)p); }
+	static inline void store(Scalar* p, Vec v) { _mm256_storeu_si256((__m256i*)p, v); }
+	static inline Vec min(Vec a, Vec b) { return _mm256_min_epi32(a, b); }
+	static inline Vec max(Vec a, Vec b) { return _mm256_max_epi32(a, b); }
+	static inline __m256i swapIndices(size_t j) {
+		int x = (int)j;
+		return _mm256_setr_epi32(0 ^ x, 1 ^ x, 2 ^ x, 3 ^ x, 4 ^ x, 5 ^ x, 6 ^ x, 7 ^ x);
+	}
+	static inline Vec swapLanes(Vec v, size_t j) { return _mm256_permutevar8x32_epi32(v, swapIndices(j)); }
+	static inline __m256i highLanes(size_t i, size_t j, size_t k) {
+		__m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		__m256i upper = _mm256_cmpeq_epi32(_mm256_and_si256(lane, _mm256_set1_epi32((int)j)), _mm256_set1_epi32((int)j));
+		__m256i descending = k >= lanes ? _mm256_set1_epi32(-(int)((i & k) != 0))
+			: _mm256_cmpeq_epi32(_mm256_and_si256(lane, _mm256_set1_epi32((int)k)), _mm256_set1_epi32((int)k));
+		return _mm256_xor_si256(upper, descending);
+	}
+	static inline Vec blend(Vec low, Vec high, __m256i mask) { return _mm256_blendv_epi8(low, high, mask); }
+};
+
+struct Avx2Int64 {
+	typedef int64_t Scalar;
+	typedef __m256i Vec;
+	static const size_t lanes = 4;
+	static inline Vec load(const Scalar* p) { return _mm256_loadu_si256((const __m256i*)p); }
+	static inline void store(Scalar* p, Vec v) { _mm256_storeu_si256((__m256i*)p, v); }
+	static inline Vec min(Vec a, Vec b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+	static inline Vec max(Vec a, Vec b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+	static inline Vec swapLanes(Vec v, size_t j) {
+		return j == 1 ? _mm256_permute4x64_epi64(v, _MM_SHUFFLE(2, 3, 0, 1)) : _mm256_permute4x64_epi64(v, _MM_SHUFFLE(1, 0, 3, 2));
+	}
+	static inline __m256i highLanes(size_t i, size_t j, size_t k) {
+		__m256i lane = _mm256_setr_epi64x(0, 1, 2, 3);
+		__m256i upper = _mm256_cmpeq_epi64(_mm256_and_si256(lane, _mm256_set1_epi64x((long long)j)), _mm256_set1_epi64x((long long)j));
+		__m256i descending = k >= lanes ? _mm256_set1_epi64x(-(long long)((i & k) != 0))
+			: _mm256_cmpeq_epi64(_mm256_and_si256(lane, _mm256_set1_epi64x((long long)k)), _mm256_set1_epi64x((long long)k));
+		return _mm256_xor_si256(upper, descending);
+	}
+	static inline Vec blend(Vec low, Vec high, __m256i mask) { return _mm256_blendv_epi8(low, high, mask); }
+};
+
+struct Avx2Float {
+	typedef float Scalar;
+	typedef __m256 Vec;
+	static const size_t lanes = 8;
+	static inline Vec load(const Scalar* p) { return _mm256_loadu_ps(p); }
+	static inline void store(Scalar* p, Vec v) { _mm256_storeu_ps(p, v); }
+	static inline Vec min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+	static inline Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+	static inline Vec swapLanes(Vec v, size_t j) { return _mm256_permutevar8x32_ps(v, Avx2Int32::swapIndices(j)); }
+	static inline __m256i highLanes(size_t i, size_t j, size_t k) { return Avx2Int32::highLanes(i, j, k); }
+	static inline Vec blend(Vec low, Vec high, __m256i mask) { return _mm256_blendv_ps(low, high, _mm256_castsi256_ps(mask)); }
+};
+
+struct Avx2Double {
+	typedef double Scalar;
+	typedef __m256d Vec;
+	static const size_t lanes = 4;
+	static inline Vec load(const Scalar* p) { return _mm256_loadu_pd(p); }
+	static inline void store(Scalar* p, Vec v) { _mm256_storeu_pd(p, v); }
+	static inline Vec min(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+	static inline Vec max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+	static inline Vec swapLanes(Vec v, size_t j) {
+		return j == 1 ? _mm256_permute4x64_pd(v, _MM_SHUFFLE(2, 3, 0, 1)) : _mm256_permute4x64_pd(v, _MM_SHUFFLE(1, 0, 3, 2));
+	}
+	static inline __m256i highLanes(size_t i, size_t j, size_t k) { return Avx2Int64::highLanes(i, j, k); }
+	static inline Vec blend(Vec low, Vec high, __m256i mask) { return _mm256_blendv_pd(low, high, _mm256_castsi256_pd(mask)); }
+};
+
+// same network as bitonicNetworkSse4, compiled for AVX2
+template<class V>
+void bitonicNetworkAvx2(typename V::Scalar* data, size_t n) {
+	for (size_t k = 2; k <= n; k <<= 1) {
+		for (size_t j = k >> 1; j > 0; j >>= 1) {
+			for (size_t i = 0; i < n; i += V::lanes) {
+				if (j >= V::lanes) {
+					if (i & j) continue;
+					typename V::Vec a = V::load(data + i);
+					typename V::Vec b = V::load(data + i + j);
+					bool ascending = (i & k) == 0;
+					// min and max of floats return their second argument on ties, so the second one takes (b, a) to keep both
+					// of two equal but different values (-0.0 and 0.0) instead of writing b twice
+					V::store(data + i, ascending ? V::min(a, b) : V::max(a, b));
+					V::store(data + i + j, ascending ? V::max(b, a) : V::min(b, a));
+				}
+				else {
+					typename V::Vec v = V::load(data + i);
+					typename V::Vec partner = V::swapLanes(v, j);
+					V::store(data + i, V::blend(V::min(v, partner), V::max(v, partner), V::highLanes(i, j, k)));
+				}
+			}
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
+
+// the value we pad blocks with, it has to sort after every real element
+template<typename T>
+T sortingNetworkPadding() {
+	return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+}
+
+/*
+	Runs the network of the given instruction set on a block of size elements (size is 8, 16, 32 or 64)
+	Sse4Traits and Avx2Traits are the traits structs of T for each instruction set
+*/
+template<class Sse4Traits, class Avx2Traits, typename T>
+void sortingNetworkBlock(T* block, size_t size, SimdLevel level) {
+#if defined(SORTING_NETWORK_X86)
+	if (level == SIMD_AVX2) {
+		bitonicNetworkAvx2<Avx2Traits>(block, size);
+		return;
+	}
+	if (level == SIMD_SSE4) {
+		bitonicNetworkSse4<Sse4Traits>(block, size);
+		return;
+	}
+#endif
+	bitonicNetworkScalar(block, size);
+}
+
+/*
+	Sorts [first, last) with a sorting network: the range is copied into a padded block, sorted in place and copied back
+	Ranges longer than SORTING_NETWORK_MAX_SIZE fall back to insertion sort (callers should only hand us leaf ranges)
+	so do ranges shorter than SORTING_NETWORK_MIN_SIZE, where padding up to a full block costs more than insertion sort
+	NaNs are not supported for floats and doubles (min/max do not order them)
+*/
+template<class Sse4Traits, class Avx2Traits, typename T>
+void sortingNetworkSort(T* first, T* last, SimdLevel level) {
+	size_t n = last - first;
+	if (n < 2) return;
+	if (n < SORTING_NETWORK_MIN_SIZE || n > SORTING_NETWORK_MAX_SIZE) {
+		insertionSort(first, last);
+		return;
+	}
+	size_t size = 8;
+	while (size < n) size <<= 1;
+
+	T block[SORTING_NETWORK_MAX_SIZE];
+	std::copy(first, last, block);
+	std::fill(block + n, block + size, sortingNetworkPadding<T>());
+	sortingNetworkBlock<Sse4Traits, Avx2Traits>(block, size, level);
+	std::copy(block, block + n, first);
+}
+
+#if !defined(SORTING_NETWORK_X86)
+// without x86 there are no vector traits, only the scalar network is ever used
+struct Sse4Int32 {}; struct Sse4Int64 {}; struct Sse4Float {}; struct Sse4Double {};
+struct Avx2Int32 {}; struct Avx2Int64 {}; struct Avx2Float {}; struct Avx2Double {};
+#endif
+
+/*
+	Small sort kernel for the leaf ranges of the divide and conquer sorts
+	int32, int64, float and double ranges of up to SORTING_NETWORK_MAX_SIZE elements go through the sorting networks
+	every other type (or an explicit comparator) uses insertion sort
+*/
+inline void smallSort(int32_t* first, int32_t* last) {
+	sortingNetworkSort<Sse4Int32, Avx2Int32>(first, last, simdLevel());
+}
+
+inline void smallSort(int64_t* first, int64_t* last) {
+	sortingNetworkSort<Sse4Int64, Avx2Int64>(first, last, simdLevel());
+}
+
+inline void smallSort(float* first, float* last) {
+	sortingNetworkSort<Sse4Float, Avx2Float>(first, last, simdLevel());
+}
+
+inline void smallSort(double* first, double* last) {
+	sortingNetworkSort<Sse4Double, Avx2Double>(first, last, simdLevel());
+}
+
+template<typename T>
+void smallSort(T* first, T* last) {
+	insertionSort(first, last);
+}
+
+template<class RandomAccessIterator, class Compare>
+void smallSort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+	insertionSort(first, last, cmp);
+}
+
+/*
+	Can the leaves of a comparison sort on RandomAccessIterator with Compare go through smallSort's networks?
+	Only for contiguous ranges (pointers and vector iterators) of int32, int64, float and double that are sorted in ascending order
+	with std::less, since the networks always sort ascending with min/max and never call the comparator
+*/
+template<class RandomAccessIterator, class Compare>
+struct UsesSortingNetwork {
+	typedef typename std::iterator_traits<RandomAccessIterator>::value_type T;
+	static const bool value =
+		(std::is_same<T, int32_t>::value || std::is_same<T, int64_t>::value || std::is_same<T, float>::value || std::is_same<T, double>::value) &&
+		(std::is_pointer<RandomAccessIterator>::value || std::is_same<RandomAccessIterator, typename std::vector<T>::iterator>::value) &&
+		(std::is_same<Compare, std::less<T>>::value || std::is_same<Compare, std::less<>>::value);
+};
+
+template<class RandomAccessIterator, class Compare>
+void leafSort(RandomAccessIterator first, RandomAccessIterator last, Compare, std::true_type) {
+	if (last - first < 2) return;
+	smallSort(&*first, &*first + (last - first));
+}
+
+template<class RandomAccessIterator, class Compare>
+void leafSort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp, std::false_type) {
+	insertionSort(first, last, cmp);
+}
+
+// leaf size for the sorts whose leaves go through the networks, blocks of 16 are too little work to pay for the copies
+const std::ptrdiff_t SORTING_NETWORK_LEAF_SIZE = 32;
+
+/*
+	Largest range the sorts should hand to leafSort: threshold (the insertion sort cutoff of the sort) for insertion sort leaves,
+	bigger leaves when they go through the networks
+*/
+template<class RandomAccessIterator, class Compare>
+std::ptrdiff_t leafSortThreshold(std::ptrdiff_t threshold) {
+	return UsesSortingNetwork<RandomAccessIterator, Compare>::value ? SORTING_NETWORK_LEAF_SIZE : threshold;
+}
+
+/*
+	Base case of introsort and quicksort: the sorting networks when UsesSortingNetwork allows it, insertion sort otherwise
+	The networks are not stable (a -0.0 and a 0.0 can swap places), so the stable sorts keep their insertion sort leaves
+*/
+template<class RandomAccessIterator, class Compare>
+void leafSort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp) {
+	leafSort(first, last, cmp, std::integral_constant<bool, UsesSortingNetwork<RandomAccessIterator, Compare>::value>());
+}
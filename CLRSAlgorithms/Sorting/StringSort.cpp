@@ -0,0 +1,249 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <cstddef>
+
+/*
+	Sorts that are specialized for strings
+	A comparison sort compares two strings character by character from the start every time,
+	so strings that share long prefixes (URLs for example) get their prefixes scanned over and over again
+	Both sorts here only look at the characters after the prefix that is already known to be shared, so the character work is
+	O(D + nlog(n)) where D is the size of the distinguishing prefixes (the characters we need to tell every string apart)
+	They work on ranges of std::string (or std::string_view, or anything with size() and operator[] returning char)
+	and order strings byte by byte like std::string does
+*/
+
+// character of s at depth as an unsigned byte, or -1 past the end so that a prefix sorts before the longer strings
+template<class String>
+inline int characterAt(const String& s, size_t depth) {
+	return depth < s.size() ? (int)(unsigned char)s[depth] : -1;
+}
+
+// length of the longest common prefix of a and b, where we already know that they share their first depth characters
+template<class String>
+size_t longestCommonPrefix(const String& a, const String& b, size_t depth) {
+	size_t n = std::min(a.size(), b.size());
+	while (depth < n && a[depth] == b[depth]) depth++;
+	return depth;
+}
+
+// a < b for strings that share their first depth characters
+template<class String>
+bool stringLessFrom(const String& a, const String& b, size_t depth) {
+	size_t prefix = longestCommonPrefix(a, b, depth);
+	return characterAt(a, prefix) < characterAt(b, prefix);
+}
+
+// ranges with at most this many strings are finished with insertion sort
+const std::ptrdiff_t STRING_SORT_INSERTION_THRESHOLD = 16;
+
+// insertion sort for strings that share their first depth characters (so we never compare those again)
+template<class RandomAccessIterator>
+void stringInsertionSort(RandomAccessIterator first, RandomAccessIterator last, size_t depth) {
+	if (first == last) return;
+	for (RandomAccessIterator i = first + 1; i != last; i++) {
+		auto key = std::move(*i);
+		RandomAccessIterator j = i;
+		for (; j != first && stringLessFrom(key, *(j - 1), depth); j--) {
+			*j = std::move(*(j - 1));
+		}
+		*j = std::move(key);
+	}
+}
+
+/*
+	Multikey quicksort (three way radix quicksort, Bentley and Sedgewick)
+	Every range is three way partitioned on the character at its depth: the < and > parts stay at the same depth
+	and only the == part moves on to the next character, so no character of the shared prefix is looked at twice
+	We keep the character at the current depth of every string in a cache array and swap it along with the strings,
+	so partitioning reads a contiguous int array instead of chasing every string's characters
+	The < and > parts keep their cached characters, only the == part has to fill its cache again one level deeper
+	Uses an explicit stack (like quicksort) since long shared prefixes would make the recursion very deep. Not stable
+*/
+template<class RandomAccessIterator>
+void multikeyQuicksort(RandomAccessIterator first, RandomAccessIterator last) {
+	using namespace std;
+	ptrdiff_t n = last - first;
+	if (n < 2) return;
+
+	struct Task {
+		ptrdiff_t low;
+		ptrdiff_t high;
+		size_t depth;
+		bool cached;
+	};
+	vector<int> cache = vector<int>(n);
+	vector<Task> stack;
+	Task initial = { 0, n, 0, false };
+	stack.push_back(initial);
+
+	while (!stack.empty()) {
+		Task task = stack.back();
+		stack.pop_back();
+		ptrdiff_t size = task.high - task.low;
+		if (size < 2) continue;
+		if (size <= STRING_SORT_INSERTION_THRESHOLD) {
+			stringInsertionSort(first + task.low, first + task.high, task.depth);
+			continue;
+		}
+		if (!task.cached) {
+			for (ptrdiff_t i = task.low; i < task.high; i++) {
+				cache[i] = characterAt(first[i], task.depth);
+			}
+		}
+
+		// median of three characters as the pivot
+		int a = cache[task.low];
+		int b = cache[task.low + size / 2];
+		int c = cache[task.high - 1];
+		int pivot = max(min(a, b), min(max(a, b), c));
+
+		// dutch national flag partition on the cached characters: [low, lt) <, [lt, gt] ==, (gt, high) >
+		ptrdiff_t lt = task.low;
+		ptrdiff_t i = task.low;
+		ptrdiff_t gt = task.high - 1;
+		while (i <= gt) {
+			int character = cache[i];
+			if (character < pivot) {
+				iter_swap(first + lt, first + i);
+				swap(cache[lt], cache[i]);
+				lt++;
+				i++;
+			}
+			else if (character > pivot) {
+				iter_swap(first + i, first + gt);
+				swap(cache[i], cache[gt]);
+				gt--;
+			}
+			else {
+				i++;
+			}
+		}
+
+		Task less = { task.low, lt, task.depth, true };
+		Task greater = { gt + 1, task.high, task.depth, true };
+		stack.push_back(less);
+		stack.push_back(greater);
+		// if the pivot is the end of the string, the == part is a block of identical strings and is already done
+		if (pivot != -1) {
+			Task equal = { lt, gt + 1, task.depth + 1, false };
+			stack.push_back(equal);
+		}
+	}
+}
+
+/*
+	LCP merge (Ng and Kakehi): merges the sorted runs a and b into out, where lcpA[i] is the longest common prefix of a[i-1] and a[i] (same for b)
+	We track how many characters the next string of each run shares with the last string we wrote out:
+		if one run shares more, its string is the smaller one and we did not have to look at a single character
+		if they share the same amount, we only compare characters from that point on
+	outLcp gets the lcp array of the merged run. Stable: on equal strings we take from a
+*/
+template<class InputIterator1, class InputIterator2, class OutputIterator>
+void lcpMerge(InputIterator1 a, const size_t* lcpA, std::ptrdiff_t lengthA, InputIterator2 b, const size_t* lcpB, std::ptrdiff_t lengthB, OutputIterator out, size_t* outLcp) {
+	std::ptrdiff_t i = 0;
+	std::ptrdiff_t j = 0;
+	std::ptrdiff_t k = 0;
+	// lcp of a[i] and b[j] with the last string written out
+	size_t sharedA = 0;
+	size_t sharedB = 0;
+
+	while (i < lengthA && j < lengthB) {
+		bool takeA;
+		if (sharedA != sharedB) {
+			takeA = sharedA > sharedB;
+		}
+		else {
+			size_t prefix = longestCommonPrefix(a[i], b[j], sharedA);
+			takeA = characterAt(a[i], prefix) <= characterAt(b[j], prefix);
+			// whichever string stays behind shares prefix characters with the one we write out now
+			if (takeA) {
+				sharedB = prefix;
+			}
+			else {
+				sharedA = prefix;
+			}
+		}
+
+		if (takeA) {
+			out[k] = std::move(a[i]);
+			outLcp[k] = sharedA;
+			i++;
+			if (i < lengthA) sharedA = lcpA[i];
+		}
+		else {
+			out[k] = std::move(b[j]);
+			outLcp[k] = sharedB;
+			j++;
+			if (j < lengthB) sharedB = lcpB[j];
+		}
+		k++;
+	}
+
+	// the first leftover string shares sharedA (or sharedB) with the last output, the rest keep their own lcps
+	for (; i < lengthA; i++, k++) {
+		out[k] = std::move(a[i]);
+		outLcp[k] = sharedA;
+		if (i + 1 < lengthA) sharedA = lcpA[i + 1];
+	}
+	for (; j < lengthB; j++, k++) {
+		out[k] = std::move(b[j]);
+		outLcp[k] = sharedB;
+		if (j + 1 < lengthB) sharedB = lcpB[j + 1];
+	}
+}
+
+template<class RandomAccessIterator, class BufferIterator>
+void lcpMergeSortInto(RandomAccessIterator first, size_t* lcp, std::ptrdiff_t n, BufferIterator out, size_t* outLcp);
+
+// sorts first[0..n) in place and fills lcp, using buffer and bufferLcp as scratch (same ping pong as mergeSortWithBuffer)
+template<class RandomAccessIterator, class BufferIterator>
+void lcpMergeSortWithBuffer(RandomAccessIterator first, size_t* lcp, std::ptrdiff_t n, BufferIterator buffer, size_t* bufferLcp) {
+	if (n <= STRING_SORT_INSERTION_THRESHOLD) {
+		stringInsertionSort(first, first + n, 0);
+		if (n > 0) lcp[0] = 0;
+		for (std::ptrdiff_t i = 1; i < n; i++) {
+			lcp[i] = longestCommonPrefix(first[i - 1], first[i], 0);
+		}
+		return;
+	}
+	std::ptrdiff_t middle = n / 2;
+	lcpMergeSortInto(first, lcp, middle, buffer, bufferLcp);
+	lcpMergeSortInto(first + middle, lcp + middle, n - middle, buffer + middle, bufferLcp + middle);
+	lcpMerge(buffer, bufferLcp, middle, buffer + middle, bufferLcp + middle, n - middle, first, lcp);
+}
+
+// sorts first[0..n) into out and fills outLcp, first and lcp are the scratch space this time
+template<class RandomAccessIterator, class BufferIterator>
+void lcpMergeSortInto(RandomAccessIterator first, size_t* lcp, std::ptrdiff_t n, BufferIterator out, size_t* outLcp) {
+	if (n <= STRING_SORT_INSERTION_THRESHOLD) {
+		lcpMergeSortWithBuffer(first, lcp, n, out, outLcp);
+		std::move(first, first + n, out);
+		std::copy(lcp, lcp + n, outLcp);
+		return;
+	}
+	std::ptrdiff_t middle = n / 2;
+	lcpMergeSortWithBuffer(first, lcp, middle, out, outLcp);
+	lcpMergeSortWithBuffer(first + middle, lcp + middle, n - middle, out + middle, outLcp + middle);
+	lcpMerge(first, lcp, middle, first + middle, lcp + middle, n - middle, out, outLcp);
+}
+
+/*
+	Stable LCP merge sort of a range of strings
+	Returns the lcp array of the sorted range (result[i] is the longest common prefix of the strings at i-1 and i, result[0] is 0)
+	which is useful on its own, for prefix compression of sorted keys for example
+*/
+template<class RandomAccessIterator>
+std::vector<size_t> lcpMergeSort(RandomAccessIterator first, RandomAccessIterator last) {
+	typedef typename std::iterator_traits<RandomAccessIterator>::value_type String;
+	std::ptrdiff_t n = last - first;
+	std::vector<size_t> lcp = std::vector<size_t>(n);
+	if (n == 0) return lcp;
+	std::vector<String> buffer(first, last);
+	std::vector<size_t> bufferLcp = std::vector<size_t>(n);
+	lcpMergeSortWithBuffer(first, lcp.data(), n, buffer.begin(), bufferLcp.data());
+	return lcp;
+}